@@ -0,0 +1,90 @@
+#include "admission_control.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+#include <deque>
+#include <map>
+
+namespace
+{
+struct Lane
+{
+    const char *name;
+    int maxRunning;
+    int maxQueued;
+    int running;
+    std::deque<message::ptr> queue;
+};
+
+Lane runtimeEnvLane = {"runtime_env", 1, 2, 0, {}};
+Lane prototypeDeployLane = {"prototype_deploy", 1, 4, 0, {}};
+
+// the vss mapping pipeline and the factory resets restart the whole runtime env, deployments share the prototype folder
+const std::map<std::string, Lane *> laneOfCmd = {
+    {"vss_mapping", &runtimeEnvLane},
+    {"vss_mapping_factory_reset", &runtimeEnvLane},
+    {"factory_reset", &runtimeEnvLane},
+    {"deploy_request", &prototypeDeployLane},
+    {"deploy_AraApp_Request", &prototypeDeployLane},
+};
+
+QMutex admissionMutex;
+
+Lane *LaneOf(const std::string &cmd)
+{
+    auto it = laneOfCmd.find(cmd);
+    if (it == laneOfCmd.end())
+    {
+        return nullptr;
+    }
+    return it->second;
+}
+}
+
+AdmissionControl::Decision AdmissionControl::Admit(const std::string &cmd, message::ptr const &data, int &queuePosition)
+{
+    queuePosition = 0;
+    Lane *lane = LaneOf(cmd);
+    if (!lane)
+    {
+        return Admitted;
+    }
+
+    QMutexLocker locker(&admissionMutex);
+    if (lane->running < lane->maxRunning)
+    {
+        lane->running++;
+        return Admitted;
+    }
+    if ((int)lane->queue.size() >= lane->maxQueued)
+    {
+        qDebug() << __func__ << __LINE__ << " : " << lane->name << " is busy, reject " << QString::fromStdString(cmd);
+        return Rejected;
+    }
+    lane->queue.push_back(data);
+    queuePosition = lane->queue.size();
+    qDebug() << __func__ << __LINE__ << " : " << lane->name << " is busy, queue " << QString::fromStdString(cmd) << " at " << queuePosition;
+    return Queued;
+}
+
+message::ptr AdmissionControl::Next(const std::string &cmd)
+{
+    Lane *lane = LaneOf(cmd);
+    if (!lane)
+    {
+        return nullptr;
+    }
+
+    QMutexLocker locker(&admissionMutex);
+    if (!lane->queue.empty())
+    {
+        message::ptr next = lane->queue.front();
+        lane->queue.pop_front();
+        return next;
+    }
+    if (lane->running > 0)
+    {
+        lane->running--;
+    }
+    return nullptr;
+}
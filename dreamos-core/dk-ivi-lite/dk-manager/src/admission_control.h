@@ -0,0 +1,31 @@
+#ifndef ADMISSION_CONTROL_H
+#define ADMISSION_CONTROL_H
+
+#include <string>
+#include <sio_client.h>
+
+using namespace sio;
+
+// Concurrency limits for the heavy messageToKit commands (vss mapping, factory reset, deployments).
+// Commands of the same lane share a limit of running handlers and a bounded wait queue. Requests over
+// the limit are parked here instead of spawning a thread that blocks on a mutex; the handler that frees
+// the slot picks them up. Commands without a lane are always admitted.
+class AdmissionControl
+{
+public:
+    enum Decision
+    {
+        Admitted,
+        Queued,
+        Rejected
+    };
+
+    // queuePosition is 1-based for Queued, 0 otherwise.
+    static Decision Admit(const std::string &cmd, message::ptr const &data, int &queuePosition);
+
+    // Called by a handler that finished `cmd`. Returns the next parked request of the lane, which the
+    // caller then owns together with the running slot, or nullptr once the slot is released.
+    static message::ptr Next(const std::string &cmd);
+};
+
+#endif // ADMISSION_CONTROL_H
@@ -0,0 +1,152 @@
+// Heap allocations of the deploy write path for a large convertedCode payload:
+//   legacy : std::string copy -> QString::fromStdString -> FileUtils::WriteFile (QTextStream)
+//   bytes  : BlobStore::ResolvePayload (view of the sio string, stored in an empty blob store with PutContent)
+//            -> FileUtils::WriteFileBytes, the code DeploymentHandler runs
+// Allocations are counted by interposing malloc/calloc/realloc (glibc), which also covers operator new
+// and Qt containers. A "large" allocation is one of at least half the payload size, i.e. a payload copy.
+//
+//   dk_manager_deploy_alloc_bench [payload MB] [iterations]
+//
+// Exits with 1 if the byte path needs more than one payload-sized allocation.
+
+#include <sio_message.h>
+#include <QByteArray>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "../blob_store.h"
+#include "../fileutils.h"
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+namespace
+{
+std::atomic<bool> g_counting{false};
+std::atomic<size_t> g_largeThreshold{0};
+std::atomic<long> g_allocs{0};
+std::atomic<long> g_largeAllocs{0};
+std::atomic<size_t> g_bytes{0};
+
+void Count(size_t size)
+{
+    if (g_counting.load(std::memory_order_relaxed))
+    {
+        g_allocs++;
+        g_bytes += size;
+        if (size >= g_largeThreshold.load(std::memory_order_relaxed))
+        {
+            g_largeAllocs++;
+        }
+    }
+}
+
+struct Sample
+{
+    long allocs = 0;
+    long largeAllocs = 0;
+    size_t bytes = 0;
+    qint64 elapsedUs = 0;
+};
+
+template <typename F>
+Sample Measure(F op)
+{
+    g_allocs = 0;
+    g_largeAllocs = 0;
+    g_bytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    g_counting = true;
+    op();
+    g_counting = false;
+    Sample sample;
+    sample.elapsedUs = timer.nsecsElapsed() / 1000;
+    sample.allocs = g_allocs;
+    sample.largeAllocs = g_largeAllocs;
+    sample.bytes = g_bytes;
+    return sample;
+}
+
+void Print(const char *name, const Sample &s, size_t payloadSize)
+{
+    std::printf("%-7s allocs=%-6ld payload-sized=%-3ld allocated=%8.2f MB (%.1fx payload)  %8.1f ms\n",
+                name, s.allocs, s.largeAllocs, s.bytes / 1048576.0, double(s.bytes) / payloadSize, s.elapsedUs / 1000.0);
+}
+}
+
+extern "C" void *malloc(size_t size)
+{
+    Count(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    Count(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    Count(size);
+    return __libc_realloc(ptr, size);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t payloadMb = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 8;
+    int iterations = (argc > 2) ? std::atoi(argv[2]) : 5;
+    size_t payloadSize = payloadMb * 1024 * 1024;
+    g_largeThreshold = payloadSize / 2;
+
+    // a deploy_request as it comes out of the sio client
+    std::string code;
+    code.reserve(payloadSize);
+    while (code.size() < payloadSize)
+    {
+        code += "    self.Vehicle.Body.Lights.Beam.Low.IsOn.set(True)  # generated\n";
+    }
+    code.resize(payloadSize);
+    sio::message::ptr data = sio::object_message::create();
+    data->get_map()["convertedCode"] = sio::string_message::create(code);
+    code.clear();
+    code.shrink_to_fit();
+
+    QString path = QDir::tempPath() + "/dk_manager_deploy_alloc_bench.py";
+    QString storeDir = QDir::tempPath() + "/dk_manager_deploy_alloc_bench_blobs/";
+    BlobStore store(storeDir);
+    std::printf("payload %zu MB, %d iterations, target %s\n", payloadMb, iterations, qPrintable(path));
+
+    Sample legacy;
+    Sample bytes;
+    for (int i = 0; i < iterations; i++)
+    {
+        legacy = Measure([&]() {
+            std::string convertedCode = data->get_map()["convertedCode"]->get_string();
+            FileUtils::WriteFile(path, QString::fromStdString(convertedCode));
+        });
+        // a first deploy of the artifact: the blob is written, not only touched
+        QDir(storeDir).removeRecursively();
+        bytes = Measure([&]() {
+            QByteArray convertedCode;
+            QString missingHash;
+            if (store.ResolvePayload(data, "convertedCode", convertedCode, missingHash))
+            {
+                FileUtils::WriteFileBytes(path, convertedCode.constData(), convertedCode.size());
+            }
+        });
+    }
+    Print("legacy", legacy, payloadSize);
+    Print("bytes", bytes, payloadSize);
+    QFile::remove(path);
+    QDir(storeDir).removeRecursively();
+
+    return (bytes.largeAllocs <= 1) ? 0 : 1;
+}
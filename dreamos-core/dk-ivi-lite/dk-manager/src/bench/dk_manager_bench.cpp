@@ -0,0 +1,472 @@
+// Replays messageToKit traffic against a dk_manager connected to a local socket.io stand-in server
+// and reports latency (p50/p99/max) and throughput per command.
+//
+// dk_manager is started with DK_SERVER_URL pointing to the stand-in, DK_ROOT_DIR in a temp folder
+// and the docker/dapr/sudo stubs of bench/stubs first in PATH, so no kit, server, docker or dapr is needed.
+//
+//   dk_manager_bench --synthetic --count 500 --rate 50 --mix list_prototypes=10,get-log=5,deploy_request=2,vss_mapping=1
+//   dk_manager_bench --replay traffic.jsonl --speed 2
+//   dk_manager_bench --synthetic --json result.json --baseline baseline.json --tolerance 0.25
+//
+// A replay file has one messageToKit payload per line, optionally wrapped as {"t_ms": <offset>, "data": {...}};
+// without t_ms the messages are sent at --rate. request_from is replaced to match replies to requests.
+
+#include "sio_standin_server.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QHash>
+#include <QMap>
+#include <QProcess>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+struct Request
+{
+    qint64 atMs = 0; // offset from the start of the run
+    QString label;
+    QJsonObject data;
+};
+
+struct Pending
+{
+    QString label;
+    qint64 sentNs = 0;
+};
+
+struct Stats
+{
+    int sent = 0;
+    int replies = 0;
+    int busy = 0;
+    int rejected = 0;
+    QVector<double> latenciesMs;
+};
+
+QString LabelOf(const QJsonObject &data)
+{
+    QString cmd = data.value("cmd").toString();
+    if (cmd == "action_on_prototype")
+    {
+        return data.value("action").toString();
+    }
+    return cmd;
+}
+
+double Percentile(QVector<double> sorted, double p)
+{
+    if (sorted.isEmpty())
+    {
+        return 0;
+    }
+    int rank = qBound(0, int(p * sorted.size() + 0.999999) - 1, sorted.size() - 1);
+    return sorted[rank];
+}
+
+QJsonObject Synthetic(const QString &label, int seq, int payloadKb)
+{
+    QJsonObject data;
+    if (label == "list_prototypes" || label == "get_support_apis" || label == "get_databroker_status")
+    {
+        data["cmd"] = label;
+    }
+    else if (label == "deploy_request")
+    {
+        QString code;
+        code.reserve(payloadKb * 1024);
+        while (code.size() < payloadKb * 1024)
+        {
+            code += "    await self.Vehicle.Body.Lights.Beam.Low.IsOn.set(True)  # generated\n";
+        }
+        data["cmd"] = label;
+        data["prototype"] = QJsonObject{{"name", "bench"}, {"id", QString("bench_%1").arg(seq % 8)}};
+        data["convertedCode"] = code;
+    }
+    else if (label == "vss_mapping")
+    {
+        QJsonObject config{{"ecuName", "bench"}, {"aliveMessageID", "0x100"}, {"dbcFilename", "bench.dbc"}, {"mappingItems", QJsonArray()}};
+        data["cmd"] = label;
+        data["data"] = QJsonObject{{"cmd", QString::fromUtf8(QJsonDocument(config).toJson(QJsonDocument::Compact))},
+                                   {"payload", "VERSION \"\"\n\nBO_ 256 BENCH: 8 Vector__XXX\n"}};
+    }
+    else
+    {
+        // get-log, get-python-code, start, stop, ...
+        data["cmd"] = "action_on_prototype";
+        data["action"] = label;
+        data["prototype_id"] = QString("bench_%1").arg(seq % 8);
+    }
+    return data;
+}
+
+QVector<Request> BuildSynthetic(const QString &mix, int count, double rate, int payloadKb)
+{
+    QVector<QPair<QString, int>> weights;
+    int total = 0;
+    for (const QString &entry : mix.split(',', Qt::SkipEmptyParts))
+    {
+        QStringList kv = entry.split('=');
+        int weight = (kv.size() > 1) ? kv[1].toInt() : 1;
+        if (weight > 0)
+        {
+            weights.append({kv[0].trimmed(), weight});
+            total += weight;
+        }
+    }
+
+    QVector<Request> requests;
+    QRandomGenerator rng(42); // same sequence on every run
+    for (int i = 0; (i < count) && (total > 0); i++)
+    {
+        int pick = rng.bounded(total);
+        QString label;
+        for (const auto &w : weights)
+        {
+            if (pick < w.second)
+            {
+                label = w.first;
+                break;
+            }
+            pick -= w.second;
+        }
+        Request request;
+        request.atMs = qint64(i * 1000.0 / rate);
+        request.label = label;
+        request.data = Synthetic(label, i, payloadKb);
+        requests.append(request);
+    }
+    return requests;
+}
+
+QVector<Request> LoadReplay(const QString &path, double rate, double speed)
+{
+    QVector<Request> requests;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "cannot open" << path;
+        return requests;
+    }
+    int i = 0;
+    while (!file.atEnd())
+    {
+        QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+        if (line.isEmpty())
+        {
+            continue;
+        }
+        Request request;
+        if (line.contains("data") && line.contains("t_ms"))
+        {
+            request.atMs = qint64(line.value("t_ms").toDouble() / speed);
+            request.data = line.value("data").toObject();
+        }
+        else
+        {
+            request.atMs = qint64(i * 1000.0 / rate);
+            request.data = line;
+        }
+        request.label = LabelOf(request.data);
+        requests.append(request);
+        i++;
+    }
+    std::stable_sort(requests.begin(), requests.end(), [](const Request &a, const Request &b) { return a.atMs < b.atMs; });
+    return requests;
+}
+
+bool MakeCertificate(const QString &dir, QString &cert, QString &key)
+{
+    cert = dir + "/bench-cert.pem";
+    key = dir + "/bench-key.pem";
+    int ret = QProcess::execute("openssl", {"req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1",
+                                            "-subj", "/CN=127.0.0.1", "-addext", "subjectAltName=IP:127.0.0.1",
+                                            "-keyout", key, "-out", cert});
+    return ret == 0;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("dk_manager_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("messageToKit latency/throughput benchmark for dk_manager");
+    parser.addHelpOption();
+    QCommandLineOption dkManagerOption("dk-manager", "dk_manager binary to start, empty to wait for one started by hand.", "path", DK_MANAGER_BIN);
+    QCommandLineOption stubsOption("stubs", "Folder with the docker/dapr/sudo stubs put first in PATH.", "dir", DK_MANAGER_BENCH_STUBS_DIR);
+    QCommandLineOption portOption("port", "Port of the stand-in server.", "port", "39700");
+    QCommandLineOption noTlsOption("no-tls", "Serve ws:// instead of wss:// (socket.io client built without TLS).");
+    QCommandLineOption syntheticOption("synthetic", "Generate traffic from --mix.");
+    QCommandLineOption replayOption("replay", "Replay messageToKit payloads from a JSONL file.", "file");
+    QCommandLineOption mixOption("mix", "Synthetic command weights.", "cmd=weight,...", "list_prototypes=10,get-log=5,deploy_request=2,vss_mapping=1");
+    QCommandLineOption countOption("count", "Number of synthetic messages.", "n", "200");
+    QCommandLineOption rateOption("rate", "Messages per second (synthetic, or replay lines without t_ms).", "rate", "20");
+    QCommandLineOption speedOption("speed", "Replay speed factor for t_ms timestamps.", "factor", "1");
+    QCommandLineOption payloadOption("payload-kb", "convertedCode size of synthetic deploys.", "kb", "256");
+    QCommandLineOption drainOption("drain-timeout", "Seconds to wait for outstanding replies.", "s", "60");
+    QCommandLineOption jsonOption("json", "Write the per-command results to a JSON file.", "file");
+    QCommandLineOption baselineOption("baseline", "Fail if p99 or throughput regress against this JSON result.", "file");
+    QCommandLineOption toleranceOption("tolerance", "Allowed regression against --baseline.", "ratio", "0.25");
+    QCommandLineOption stubDelayOption("stub-delay-ms", "Latency of every stubbed docker/dapr call.", "ms", "0");
+    parser.addOptions({dkManagerOption, stubsOption, portOption, noTlsOption, syntheticOption, replayOption, mixOption, countOption,
+                       rateOption, speedOption, payloadOption, drainOption, jsonOption, baselineOption, toleranceOption, stubDelayOption});
+    parser.process(app);
+
+    double rate = qMax(0.001, parser.value(rateOption).toDouble());
+    QVector<Request> requests;
+    if (parser.isSet(replayOption))
+    {
+        requests = LoadReplay(parser.value(replayOption), rate, qMax(0.001, parser.value(speedOption).toDouble()));
+    }
+    else
+    {
+        requests = BuildSynthetic(parser.value(mixOption), parser.value(countOption).toInt(), rate, parser.value(payloadOption).toInt());
+    }
+    if (requests.isEmpty())
+    {
+        std::fprintf(stderr, "no traffic to send\n");
+        return 2;
+    }
+
+    QTemporaryDir workDir;
+    QString cert;
+    QString key;
+    bool tls = !parser.isSet(noTlsOption);
+    if (tls && !MakeCertificate(workDir.path(), cert, key))
+    {
+        std::fprintf(stderr, "openssl failed, use --no-tls\n");
+        return 2;
+    }
+    quint16 port = quint16(parser.value(portOption).toUInt());
+    SioStandInServer server(cert, key);
+    if (!server.Listen(port))
+    {
+        return 2;
+    }
+
+    QProcess dkManager;
+    QString dkManagerBin = parser.value(dkManagerOption);
+    if (!dkManagerBin.isEmpty())
+    {
+        QDir().mkpath(workDir.path() + "/root");
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert("PATH", parser.value(stubsOption) + ":" + env.value("PATH"));
+        env.insert("DK_SERVER_URL", QString("%1://127.0.0.1:%2").arg(tls ? "https" : "http").arg(port));
+        env.insert("DK_ROOT_DIR", workDir.path() + "/root/");
+        env.insert("DK_CONTAINER_POOL_SIZE", "0");
+        env.insert("DK_BENCH_STUB_DELAY_MS", parser.value(stubDelayOption));
+        if (tls)
+        {
+            // for socket.io clients that verify the server certificate
+            env.insert("SSL_CERT_FILE", cert);
+        }
+        dkManager.setProcessEnvironment(env);
+        dkManager.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        dkManager.setStandardOutputFile(workDir.path() + "/dk_manager.log");
+        dkManager.start(dkManagerBin, QStringList());
+        std::printf("started %s, log in %s/dk_manager.log\n", qPrintable(dkManagerBin), qPrintable(workDir.path()));
+    }
+    else
+    {
+        std::printf("waiting for a dk_manager on port %u\n", port);
+    }
+
+    QMap<QString, Stats> stats;
+    QHash<QString, Pending> pending;
+    QElapsedTimer clock;
+    qint64 firstSendNs = -1;
+    qint64 lastReplyNs = 0;
+    int next = 0;
+    bool started = false;
+
+    QTimer sendTimer;
+    sendTimer.setTimerType(Qt::PreciseTimer);
+    QTimer drainTimer;
+    drainTimer.setSingleShot(true);
+    QTimer registerTimer;
+    registerTimer.setSingleShot(true);
+
+    auto finish = [&]() {
+        sendTimer.stop();
+        app.quit();
+    };
+
+    QObject::connect(&server, &SioStandInServer::EventReceived, [&](const QString &event, const QJsonValue &value) {
+        if (event == "register_kit" && !started)
+        {
+            started = true;
+            registerTimer.stop();
+            std::printf("dk_manager registered, sending %d messages\n", int(requests.size()));
+            clock.start();
+            sendTimer.start(1);
+            return;
+        }
+        if (event != "messageToKit-kitReply")
+        {
+            return;
+        }
+        QJsonObject reply = value.toObject();
+        QString id = reply.value("request_from").toString();
+        auto it = pending.find(id);
+        if (it == pending.end())
+        {
+            return;
+        }
+        if (reply.value("result").toString() == "busy")
+        {
+            if (reply.value("queue_position").toInt() == 0)
+            {
+                // the queue was full, the request was dropped and no other reply follows
+                stats[it->label].rejected++;
+                pending.erase(it);
+                if ((next >= requests.size()) && pending.isEmpty())
+                {
+                    finish();
+                }
+                return;
+            }
+            // admission control parked the request, the real reply follows
+            stats[it->label].busy++;
+            return;
+        }
+        qint64 now = clock.nsecsElapsed();
+        Stats &s = stats[it->label];
+        s.replies++;
+        s.latenciesMs.append((now - it->sentNs) / 1e6);
+        lastReplyNs = now;
+        pending.erase(it);
+        if ((next >= requests.size()) && pending.isEmpty())
+        {
+            finish();
+        }
+    });
+
+    QObject::connect(&sendTimer, &QTimer::timeout, [&]() {
+        qint64 nowMs = clock.elapsed();
+        while ((next < requests.size()) && (requests[next].atMs <= nowMs))
+        {
+            Request &request = requests[next];
+            QString id = QString("bench-%1").arg(next);
+            request.data["request_from"] = id;
+            qint64 sentNs = clock.nsecsElapsed();
+            if (firstSendNs < 0)
+            {
+                firstSendNs = sentNs;
+            }
+            pending.insert(id, Pending{request.label, sentNs});
+            stats[request.label].sent++;
+            server.Emit("messageToKit", request.data);
+            next++;
+        }
+        if (next >= requests.size())
+        {
+            sendTimer.stop();
+            if (pending.isEmpty())
+            {
+                finish();
+            }
+            else
+            {
+                drainTimer.start(parser.value(drainOption).toInt() * 1000);
+            }
+        }
+    });
+    QObject::connect(&drainTimer, &QTimer::timeout, finish);
+    QObject::connect(&registerTimer, &QTimer::timeout, [&]() {
+        std::fprintf(stderr, "dk_manager did not register within 60 s\n");
+        app.exit(2);
+    });
+    registerTimer.start(60000);
+
+    int ret = app.exec();
+
+    if (dkManager.state() != QProcess::NotRunning)
+    {
+        dkManager.terminate();
+        if (!dkManager.waitForFinished(3000))
+        {
+            dkManager.kill();
+            dkManager.waitForFinished(1000);
+        }
+    }
+    if (ret != 0)
+    {
+        return ret;
+    }
+
+    double windowS = qMax(1e-3, (lastReplyNs - firstSendNs) / 1e9);
+    QJsonObject result;
+    std::printf("\n%-22s %6s %7s %5s %8s %8s %10s %10s %10s %10s\n", "command", "sent", "replies", "busy", "rejected", "timeouts", "p50 ms", "p99 ms", "max ms", "replies/s");
+    for (auto it = stats.begin(); it != stats.end(); ++it)
+    {
+        Stats &s = it.value();
+        std::sort(s.latenciesMs.begin(), s.latenciesMs.end());
+        double p50 = Percentile(s.latenciesMs, 0.50);
+        double p99 = Percentile(s.latenciesMs, 0.99);
+        double max = s.latenciesMs.isEmpty() ? 0 : s.latenciesMs.last();
+        double throughput = s.replies / windowS;
+        int timeouts = s.sent - s.replies - s.rejected;
+        std::printf("%-22s %6d %7d %5d %8d %8d %10.1f %10.1f %10.1f %10.2f\n", qPrintable(it.key()), s.sent, s.replies, s.busy, s.rejected, timeouts, p50, p99, max, throughput);
+        result[it.key()] = QJsonObject{{"sent", s.sent}, {"replies", s.replies}, {"busy", s.busy}, {"rejected", s.rejected}, {"timeouts", timeouts},
+                                       {"p50_ms", p50}, {"p99_ms", p99}, {"max_ms", max}, {"throughput", throughput}};
+    }
+    std::printf("window %.2f s\n", windowS);
+
+    if (parser.isSet(jsonOption))
+    {
+        QFile out(parser.value(jsonOption));
+        if (out.open(QIODevice::WriteOnly))
+        {
+            out.write(QJsonDocument(result).toJson());
+        }
+    }
+
+    int failed = 0;
+    if (parser.isSet(baselineOption))
+    {
+        QFile in(parser.value(baselineOption));
+        in.open(QIODevice::ReadOnly);
+        QJsonObject baseline = QJsonDocument::fromJson(in.readAll()).object();
+        double tolerance = parser.value(toleranceOption).toDouble();
+        for (auto it = baseline.begin(); it != baseline.end(); ++it)
+        {
+            QJsonObject base = it.value().toObject();
+            QJsonObject now = result.value(it.key()).toObject();
+            if (now.isEmpty())
+            {
+                continue;
+            }
+            double baseP99 = base.value("p99_ms").toDouble();
+            double baseThroughput = base.value("throughput").toDouble();
+            if (now.value("p99_ms").toDouble() > baseP99 * (1 + tolerance))
+            {
+                std::printf("REGRESSION %s: p99 %.1f ms, baseline %.1f ms\n", qPrintable(it.key()), now.value("p99_ms").toDouble(), baseP99);
+                failed++;
+            }
+            if (now.value("throughput").toDouble() < baseThroughput * (1 - tolerance))
+            {
+                std::printf("REGRESSION %s: %.2f replies/s, baseline %.2f\n", qPrintable(it.key()), now.value("throughput").toDouble(), baseThroughput);
+                failed++;
+            }
+            if (now.value("timeouts").toInt() > base.value("timeouts").toInt())
+            {
+                std::printf("REGRESSION %s: %d unanswered, baseline %d\n", qPrintable(it.key()), now.value("timeouts").toInt(), base.value("timeouts").toInt());
+                failed++;
+            }
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,150 @@
+#include "sio_standin_server.h"
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QSslConfiguration>
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace
+{
+const int PING_INTERVAL_MS = 25000;
+const int PING_TIMEOUT_MS = 20000;
+}
+
+SioStandInServer::SioStandInServer(const QString &certFile, const QString &keyFile, QObject *parent) : QObject(parent)
+{
+    bool secure = !certFile.isEmpty();
+    m_server = new QWebSocketServer("dk_manager_bench", secure ? QWebSocketServer::SecureMode : QWebSocketServer::NonSecureMode, this);
+    if (secure)
+    {
+        QFile cert(certFile);
+        QFile key(keyFile);
+        cert.open(QIODevice::ReadOnly);
+        key.open(QIODevice::ReadOnly);
+        QSslConfiguration ssl = QSslConfiguration::defaultConfiguration();
+        ssl.setPeerVerifyMode(QSslSocket::VerifyNone);
+        ssl.setLocalCertificate(QSslCertificate(&cert, QSsl::Pem));
+        ssl.setPrivateKey(QSslKey(&key, QSsl::Rsa, QSsl::Pem));
+        m_server->setSslConfiguration(ssl);
+    }
+    connect(m_server, &QWebSocketServer::newConnection, this, &SioStandInServer::OnNewConnection);
+    connect(&m_pingTimer, &QTimer::timeout, this, &SioStandInServer::SendPing);
+    m_pingTimer.start(PING_INTERVAL_MS);
+}
+
+SioStandInServer::~SioStandInServer()
+{
+    m_server->close();
+    qDeleteAll(m_clients);
+}
+
+bool SioStandInServer::Listen(quint16 port)
+{
+    if (!m_server->listen(QHostAddress::LocalHost, port))
+    {
+        qWarning() << "cannot listen on" << port << ":" << m_server->errorString();
+        return false;
+    }
+    return true;
+}
+
+int SioStandInServer::Emit(const QString &event, const QJsonValue &data)
+{
+    // socket.io EVENT packet "2" inside an Engine.IO MESSAGE packet "4"
+    QString packet = "42" + QString::fromUtf8(QJsonDocument(QJsonArray{event, data}).toJson(QJsonDocument::Compact));
+    for (QWebSocket *client : m_clients)
+    {
+        client->sendTextMessage(packet);
+    }
+    return m_clients.size();
+}
+
+void SioStandInServer::OnNewConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QWebSocket *client = m_server->nextPendingConnection();
+        connect(client, &QWebSocket::textMessageReceived, this, &SioStandInServer::OnTextMessage);
+        connect(client, &QWebSocket::disconnected, this, &SioStandInServer::OnDisconnected);
+        m_clients.append(client);
+
+        // Engine.IO OPEN, there is no polling transport to upgrade from
+        QJsonObject open{{"sid", QString("eio%1").arg(m_nextSid++)},
+                         {"upgrades", QJsonArray()},
+                         {"pingInterval", PING_INTERVAL_MS},
+                         {"pingTimeout", PING_TIMEOUT_MS},
+                         {"maxPayload", 1 << 30}};
+        client->sendTextMessage("0" + QString::fromUtf8(QJsonDocument(open).toJson(QJsonDocument::Compact)));
+    }
+}
+
+void SioStandInServer::OnTextMessage(const QString &message)
+{
+    QWebSocket *client = qobject_cast<QWebSocket *>(sender());
+    if (!client || message.isEmpty())
+    {
+        return;
+    }
+
+    QChar type = message.at(0);
+    if (type == '2')
+    {
+        // ping from an Engine.IO 3 style client
+        client->sendTextMessage("3" + message.mid(1));
+        return;
+    }
+    if ((type != '4') || (message.size() < 2))
+    {
+        // pong / close / noop
+        return;
+    }
+
+    QChar sioType = message.at(1);
+    if (sioType == '0')
+    {
+        // CONNECT to the default namespace
+        client->sendTextMessage(QString("40{\"sid\":\"sio%1\"}").arg(m_nextSid++));
+        Q_EMIT ClientConnected();
+        return;
+    }
+    if (sioType != '2')
+    {
+        return;
+    }
+
+    // EVENT: 42[<ack id>]["name", data]
+    int start = 2;
+    while ((start < message.size()) && message.at(start).isDigit())
+    {
+        start++;
+    }
+    QJsonArray args = QJsonDocument::fromJson(message.mid(start).toUtf8()).array();
+    if (args.isEmpty())
+    {
+        return;
+    }
+    Q_EMIT EventReceived(args.at(0).toString(), args.size() > 1 ? args.at(1) : QJsonValue());
+}
+
+void SioStandInServer::OnDisconnected()
+{
+    QWebSocket *client = qobject_cast<QWebSocket *>(sender());
+    m_clients.removeAll(client);
+    if (client)
+    {
+        client->deleteLater();
+    }
+}
+
+void SioStandInServer::SendPing()
+{
+    for (QWebSocket *client : m_clients)
+    {
+        client->sendTextMessage("2");
+    }
+}
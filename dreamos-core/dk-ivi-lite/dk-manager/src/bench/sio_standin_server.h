@@ -0,0 +1,44 @@
+#ifndef SIO_STANDIN_SERVER_H
+#define SIO_STANDIN_SERVER_H
+
+#include <QObject>
+#include <QList>
+#include <QJsonValue>
+#include <QTimer>
+
+class QWebSocketServer;
+class QWebSocket;
+
+// Just enough of a socket.io v4 server (Engine.IO 4 over websocket, default namespace, text events)
+// for dk_manager to connect, register and exchange messageToKit / messageToKit-kitReply with.
+class SioStandInServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // certFile/keyFile empty: plain ws, otherwise wss with that certificate.
+    explicit SioStandInServer(const QString &certFile = QString(), const QString &keyFile = QString(), QObject *parent = nullptr);
+    ~SioStandInServer();
+
+    bool Listen(quint16 port);
+    // Send an event to every connected client, returns the number of clients.
+    int Emit(const QString &event, const QJsonValue &data);
+
+Q_SIGNALS:
+    void ClientConnected();
+    void EventReceived(const QString &event, const QJsonValue &data);
+
+private Q_SLOTS:
+    void OnNewConnection();
+    void OnTextMessage(const QString &message);
+    void OnDisconnected();
+    void SendPing();
+
+private:
+    QWebSocketServer *m_server;
+    QList<QWebSocket *> m_clients;
+    QTimer m_pingTimer;
+    int m_nextSid = 0;
+};
+
+#endif // SIO_STANDIN_SERVER_H
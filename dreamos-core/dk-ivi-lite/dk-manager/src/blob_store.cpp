@@ -0,0 +1,217 @@
+#include "blob_store.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDirIterator>
+#include <QDateTime>
+#include <algorithm>
+#include <vector>
+
+BlobStore::BlobStore(QString store_dir, qint64 max_bytes)
+{
+    this->_store_dir = store_dir;
+    this->_max_bytes = max_bytes;
+}
+
+qint64 BlobStore::DefaultMaxBytes()
+{
+    bool ok = false;
+    qint64 mb = qgetenv("DK_BLOB_STORE_MAX_MB").toLongLong(&ok);
+    if (!ok || (mb <= 0))
+    {
+        mb = 256;
+    }
+    return mb * 1024 * 1024;
+}
+
+QString BlobStore::HashOf(const char *data, qint64 size)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(QByteArray::fromRawData(data, size),
+                                                        QCryptographicHash::Sha256).toHex());
+}
+
+bool BlobStore::IsValidHash(const QString &hash)
+{
+    if (hash.length() != 64)
+    {
+        return false;
+    }
+    for (const QChar c : hash)
+    {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString BlobStore::PathOf(const QString &hash) const
+{
+    return this->_store_dir + hash.left(2) + "/" + hash;
+}
+
+bool BlobStore::Contains(const QString &hash) const
+{
+    if (!IsValidHash(hash))
+    {
+        return false;
+    }
+    return QFileInfo::exists(PathOf(hash));
+}
+
+QStringList BlobStore::Missing(const QStringList &hashes) const
+{
+    QStringList missing;
+    for (const QString &hash : hashes)
+    {
+        if (!Contains(hash) && !missing.contains(hash))
+        {
+            missing.append(hash);
+        }
+    }
+    return missing;
+}
+
+int BlobStore::Put(const QString &hash, const char *data, qint64 size)
+{
+    if (!IsValidHash(hash) || (HashOf(data, size) != hash))
+    {
+        qDebug() << __func__ << __LINE__ << " : content does not match hash " << hash;
+        return -1;
+    }
+    return Write(hash, data, size);
+}
+
+int BlobStore::Write(const QString &hash, const char *data, qint64 size)
+{
+    if (QFileInfo::exists(PathOf(hash)))
+    {
+        // used again, keep it away from the eviction
+        QFile file(PathOf(hash));
+        if (file.open(QIODevice::ReadOnly))
+        {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return 0;
+    }
+
+    if (!QDir().mkpath(this->_store_dir + hash.left(2)))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot create blob folder for " << hash;
+        return -2;
+    }
+
+    // write through a temp file so that a half-written blob is never visible under its hash
+    QSaveFile file(PathOf(hash));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -2;
+    }
+    if ((file.write(data, size) != size) || !file.commit())
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -2;
+    }
+    Trim(hash);
+    return 0;
+}
+
+void BlobStore::Trim(const QString &keep_hash)
+{
+    struct Entry
+    {
+        QString path;
+        qint64 size;
+        QDateTime used;
+    };
+    std::vector<Entry> entries;
+    qint64 total = 0;
+    QDirIterator it(this->_store_dir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+    {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        total += info.size();
+        if (info.fileName() != keep_hash)
+        {
+            entries.push_back({info.filePath(), info.size(), info.lastModified()});
+        }
+    }
+    if (total <= this->_max_bytes)
+    {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries)
+    {
+        if (total <= this->_max_bytes)
+        {
+            break;
+        }
+        if (QFile::remove(entry.path))
+        {
+            total -= entry.size;
+            qDebug() << __func__ << __LINE__ << " : evicted " << entry.path;
+        }
+    }
+}
+
+QString BlobStore::PutContent(const char *data, qint64 size)
+{
+    QString hash = HashOf(data, size);
+    if (Write(hash, data, size) < 0)
+    {
+        return "";
+    }
+    return hash;
+}
+
+bool BlobStore::Get(const QString &hash, QByteArray &content) const
+{
+    if (!IsValidHash(hash))
+    {
+        return false;
+    }
+    QFile file(PathOf(hash));
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    content = file.readAll();
+    file.close();
+    return true;
+}
+
+bool BlobStore::ResolvePayload(sio::message::ptr const &obj, const std::string &key, QByteArray &content, QString &missingHash)
+{
+    std::map<std::string, sio::message::ptr> &fields = obj->get_map();
+
+    auto inlineIt = fields.find(key);
+    if ((inlineIt != fields.end()) && inlineIt->second && (inlineIt->second->get_flag() == sio::message::flag_string))
+    {
+        const std::string &value = inlineIt->second->get_string();
+        content = QByteArray::fromRawData(value.data(), int(value.size()));
+        PutContent(content.constData(), content.size());
+        return true;
+    }
+
+    auto hashIt = fields.find(key + "Hash");
+    if ((hashIt != fields.end()) && hashIt->second && (hashIt->second->get_flag() == sio::message::flag_string))
+    {
+        QString hash = QString::fromStdString(hashIt->second->get_string()).toLower();
+        if (Get(hash, content))
+        {
+            return true;
+        }
+        qDebug() << __func__ << __LINE__ << " : " << QString::fromStdString(key) << " blob is missing : " << hash;
+        missingHash = hash;
+    }
+    return false;
+}
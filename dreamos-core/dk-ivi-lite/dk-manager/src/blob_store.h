@@ -0,0 +1,49 @@
+#ifndef BLOB_STORE_H
+#define BLOB_STORE_H
+
+#include <QObject>
+#include <QStringList>
+#include <QByteArray>
+#include <string>
+#include <sio_message.h>
+
+// Content-addressed store for large messageToKit payloads (converted code, ara binaries, dbc text).
+// Blobs are keyed by the lowercase hex sha256 of their bytes and kept under <store_dir>/<hash[0:2]>/<hash>.
+// The store is bounded: once it holds more than max_bytes, the least recently used blobs are removed
+// (a blob's mtime is its last put or get). A removed blob is reported missing again by announce_blobs.
+class BlobStore
+{
+private:
+    QString _store_dir;
+    qint64 _max_bytes;
+    int Write(const QString &hash, const char *data, qint64 size);
+    void Trim(const QString &keep_hash);
+public:
+    BlobStore(QString store_dir, qint64 max_bytes = DefaultMaxBytes());
+
+    // DK_BLOB_STORE_MAX_MB, 256 MB if unset
+    static qint64 DefaultMaxBytes();
+
+    static QString HashOf(const char *data, qint64 size);
+    static bool IsValidHash(const QString &hash);
+
+    QString PathOf(const QString &hash) const;
+    bool Contains(const QString &hash) const;
+    QStringList Missing(const QStringList &hashes) const;
+
+    // Store bytes under the given hash. Returns 0 on success, -1 if the content
+    // does not match the hash, -2 on io error.
+    int Put(const QString &hash, const char *data, qint64 size);
+    // Hash and store bytes, returns the hash or an empty string on io error.
+    QString PutContent(const char *data, qint64 size);
+    bool Get(const QString &hash, QByteArray &content) const;
+
+    // A large payload of a messageToKit request is either sent inline under <key> or referenced by its
+    // sha256 under <key>Hash (announced with announce_blobs and uploaded with upload_blob beforehand).
+    // An inline payload is not copied: content views the string of the message, which must outlive it;
+    // it is stored as well, so that the next deploy of the same artifact can be sent by hash only.
+    // Returns false if there is neither, missingHash is set if the referenced blob isn't in the store.
+    bool ResolvePayload(sio::message::ptr const &obj, const std::string &key, QByteArray &content, QString &missingHash);
+};
+
+#endif // BLOB_STORE_H
@@ -58,9 +58,13 @@ QString CommonUtils::get_dreamkit_code(std::string dkboard_unqfile, std::string
     QString serialNo = "";
     if (FileUtils::fileExists(dkboard_unqfile))
     {
-        QString cmd = "cp " + QString::fromStdString(dkboard_unqfile) + " " + QString::fromStdString(dkdreamkit_unqfile);
-        serialNo += FileUtils::ReadFile(QString::fromStdString(dkboard_unqfile));        
-        system(cmd.toUtf8());
+        // keep a copy of the board serial, device-tree files report size 0 so read the bytes rather than QFile::copy
+        std::string boardSerial = FileUtils::ReadFileBytes(QString::fromStdString(dkboard_unqfile));
+        serialNo += QString::fromStdString(boardSerial);
+        if (FileUtils::ReadFileBytes(QString::fromStdString(dkdreamkit_unqfile)) != boardSerial)
+        {
+            FileUtils::WriteFileAtomic(QString::fromStdString(dkdreamkit_unqfile), QByteArray::fromStdString(boardSerial));
+        }
     }
     else if (FileUtils::fileExists(dkdreamkit_unqfile))
     {
@@ -77,9 +81,7 @@ QString CommonUtils::get_dreamkit_code(std::string dkboard_unqfile, std::string
         QString hashInHex = QString::number(CommonUtils::dk_hash(hashinput), 16);
         //        qDebug() << __func__ << __LINE__ << "create DreamkitID : " << hash;
         qDebug() << __func__ << __LINE__ << "create DreamkitID in hex: " << hashInHex;
-        QString cmd = "echo " + hashInHex + " > " + QString::fromStdString(dkdreamkit_unqfile) + "; sync;";
-        system(cmd.toUtf8());
-        QThread::msleep(100);
+        FileUtils::WriteFileAtomic(QString::fromStdString(dkdreamkit_unqfile), (hashInHex + "\n").toUtf8());
 
         serialNo = hashInHex;
     }
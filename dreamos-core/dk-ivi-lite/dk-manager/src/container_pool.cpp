@@ -0,0 +1,281 @@
+#include "container_pool.h"
+#include "common_utils.h"
+#include "dependency_layers.h"
+#include <QDebug>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+extern std::string DK_VCU_USERNAME;
+extern std::string DK_ARCH;
+extern std::string DK_DOCKER_HUB_NAMESPACE;
+extern std::string DK_PROTOTYPES_FOLDER;
+extern std::string DK_POOL_FOLDER;
+
+namespace
+{
+const char *POOL_PREFIX = "dk_pool_";
+
+// Moves the entries of one folder into another (same file system, so renames only).
+// On failure the entries moved so far are moved back.
+bool MoveEntries(const QString &from, const QString &to)
+{
+    QStringList entries = QDir(from).entryList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+    for (int i = 0; i < entries.size(); i++)
+    {
+        if (!QDir().rename(from + "/" + entries[i], to + "/" + entries[i]))
+        {
+            qDebug() << __func__ << __LINE__ << " : cannot move " << entries[i] << " from " << from << " to " << to;
+            while (--i >= 0)
+            {
+                QDir().rename(to + "/" + entries[i], from + "/" + entries[i]);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+ContainerPool *ContainerPool::instance()
+{
+    static ContainerPool pool;
+    return &pool;
+}
+
+ContainerPool::ContainerPool()
+{
+    bool ok = false;
+    int size = qEnvironmentVariableIntValue("DK_CONTAINER_POOL_SIZE", &ok);
+    m_size = ok ? qMax(0, size) : 2;
+}
+
+void ContainerPool::Init()
+{
+    qDebug() << __func__ << __LINE__ << " : container pool size " << m_size;
+    // containers of a previous run may be half set up, start from scratch
+    std::string cmd = "docker ps -aq --filter name=^" + std::string(POOL_PREFIX) + " | xargs -r docker rm -f";
+    CommonUtils::runLinuxCommand(cmd.c_str());
+
+    // warm apps of a previous run keep running with their staging folder; the files of those whose
+    // container is gone go back to prototypes/<id>, then the empty staging folders are dropped
+    QDir prototypes(QString::fromStdString(DK_PROTOTYPES_FOLDER));
+    for (const QFileInfo &entry : prototypes.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (entry.isSymLink() && !IsPoolContainer(entry.fileName()))
+        {
+            ReleaseApp(entry.fileName());
+        }
+    }
+    QDir pool(QString::fromStdString(DK_POOL_FOLDER));
+    for (const QString &staging : pool.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (staging.startsWith(POOL_PREFIX))
+        {
+            pool.rmdir(staging);
+        }
+    }
+    Refill();
+}
+
+int ContainerPool::StartApp(const QString &app_id)
+{
+    QString container;
+    if (!Acquire(container))
+    {
+        qDebug() << __func__ << __LINE__ << " : no warm container for " << app_id;
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // the app's files go to the container's own /app/exec, as with the bind mount of a regular docker run
+    if (!Stage(container, app_id))
+    {
+        system(("docker rm -f " + container + " > /dev/null 2>&1").toUtf8());
+        return -1;
+    }
+    int ret = system(("docker rename " + container + " " + app_id).toUtf8());
+    if (ret == 0)
+    {
+        QString cmd = LaunchCmd(app_id);
+        qDebug() << cmd;
+        ret = system(cmd.toUtf8());
+    }
+    if (ret != 0)
+    {
+        qDebug() << __func__ << __LINE__ << " : warm start of " << app_id << " failed, ret " << ret;
+        system(("docker rm -f " + container + " " + app_id + " > /dev/null 2>&1").toUtf8());
+        ReleaseApp(app_id);
+        return -1;
+    }
+    qDebug() << __func__ << __LINE__ << " : " << app_id << " started from " << container << " in " << timer.elapsed() << " ms";
+    return 0;
+}
+
+bool ContainerPool::Stage(const QString &container, const QString &app_id)
+{
+    QString prototype = QString::fromStdString(DK_PROTOTYPES_FOLDER) + app_id;
+    QString staging = QString::fromStdString(DK_POOL_FOLDER) + container;
+    if (QFileInfo(prototype).isSymLink())
+    {
+        // staged by a start that was never stopped
+        ReleaseApp(app_id);
+    }
+    if (!QFileInfo(prototype).isDir() || !QFileInfo(staging).isDir())
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot stage " << prototype << " in " << staging;
+        return false;
+    }
+
+    // prototypes/<id> becomes a link to the staging folder: dk_manager keeps reading and writing
+    // (main.log, main.py, deploys) the files the app sees, like with a bind mount of the folder
+    if (!MoveEntries(prototype, staging))
+    {
+        return false;
+    }
+    if (!QDir().rmdir(prototype) || !QFile::link("../" + QDir(QString::fromStdString(DK_POOL_FOLDER)).dirName() + "/" + container, prototype))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot link " << prototype << " to " << staging;
+        QDir().mkdir(prototype);
+        MoveEntries(staging, prototype);
+        return false;
+    }
+    return true;
+}
+
+void ContainerPool::ReleaseApp(const QString &app_id)
+{
+    QString prototype = QString::fromStdString(DK_PROTOTYPES_FOLDER) + app_id;
+    QFileInfo link(prototype);
+    if (!link.isSymLink())
+    {
+        return; // not started from the pool
+    }
+    QString staging = link.symLinkTarget();
+    if (!QFile::remove(prototype) || !QDir().mkdir(prototype) || !MoveEntries(staging, prototype))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot move " << app_id << " back from " << staging;
+        return;
+    }
+    QDir().rmdir(staging);
+}
+
+int ContainerPool::RestartApp(const QString &app_id)
+{
+    if (!IsPoolContainer(app_id))
+    {
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // SIGTERM the running main.py (its pid is recorded by LaunchCmd), give it 1 s to exit, then launch it again
+    QString cmd = "docker exec " + app_id + " sh -c 'pid=$(cat /tmp/dk_app.pid 2>/dev/null); [ -n \"$pid\" ] || exit 0; kill $pid 2>/dev/null;"
+                  " for i in 1 2 3 4 5 6 7 8 9 10; do kill -0 $pid 2>/dev/null || exit 0; sleep 0.1; done; kill -9 $pid 2>/dev/null; exit 0' && " + LaunchCmd(app_id);
+    qDebug() << cmd;
+    int ret = system(cmd.toUtf8());
+    qDebug() << __func__ << __LINE__ << " : " << app_id << " restarted in place in " << timer.elapsed() << " ms, ret " << ret;
+    return ret;
+}
+
+bool ContainerPool::IsPoolContainer(const QString &name)
+{
+    // ask docker instead of remembering: warm containers survive a dk_manager restart
+    std::string cmd = "docker inspect --format '{{index .Config.Labels \"dk.pool\"}}' " + name.toStdString() + " 2>/dev/null";
+    return QString::fromStdString(CommonUtils::runLinuxCommand(cmd.c_str())).trimmed() == "1";
+}
+
+QString ContainerPool::LaunchCmd(const QString &app_id)
+{
+    QString env;
+    QString layer = DependencyLayerCache::instance()->ReadyLayerOf(app_id);
+    if (!layer.isEmpty())
+    {
+        env = "-e PYTHONPATH=" + DependencyLayerCache::ContainerPath(layer) + ":/home/python-packages ";
+    }
+    // $! is the pid of main.py; its output goes to main.log in the app folder and, through the init
+    // process, to docker logs like the output of a regular docker run
+    return "docker exec -d " + env + app_id + " sh -c 'cd /app/exec && { python3 main.py 2>&1 & echo $! > /tmp/dk_app.pid; wait; }"
+           " | tee main.log /proc/1/fd/1 > /dev/null'";
+}
+
+bool ContainerPool::Acquire(QString &container)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_idle.isEmpty())
+        {
+            container = m_idle.takeFirst();
+        }
+    }
+    Refill();
+    return !container.isEmpty();
+}
+
+void ContainerPool::Refill()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_refilling || (m_idle.size() >= m_size))
+        {
+            return;
+        }
+        m_refilling = true;
+    }
+
+    QThreadPool::globalInstance()->start(QRunnable::create([this]() {
+        while (true)
+        {
+            QString container;
+            {
+                QMutexLocker locker(&m_mutex);
+                if (m_idle.size() >= m_size)
+                {
+                    m_refilling = false;
+                    return;
+                }
+                // skip the staging folders still used by warm apps of a previous run
+                do
+                {
+                    container = POOL_PREFIX + QString::number(m_nextId++);
+                } while (!QDir(QString::fromStdString(DK_POOL_FOLDER) + container).isEmpty());
+            }
+
+            if (!CreateContainer(container))
+            {
+                // docker or the image isn't available (yet), the next start retries
+                QMutexLocker locker(&m_mutex);
+                m_refilling = false;
+                return;
+            }
+
+            QMutexLocker locker(&m_mutex);
+            m_idle.append(container);
+        }
+    }));
+}
+
+bool ContainerPool::CreateContainer(const QString &container)
+{
+    QString home = "/home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/";
+    // --init: sleep as PID 1 would ignore the SIGTERM of docker stop and every stop would take the full timeout
+    QString cmd = "docker run -d --init --name " + container + " --label dk.pool=1 --log-opt max-size=10m --log-opt max-file=3";
+    cmd += " -v " + home + "dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro";
+    cmd += " -v " + home + "dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro";
+    // a staging folder of its own, it receives the files of the app the container is handed to
+    if (!QDir().mkpath(QString::fromStdString(DK_POOL_FOLDER) + container))
+    {
+        return false;
+    }
+    cmd += " -v " + home + "dk_manager/pool/" + container + ":/app/exec";
+    cmd += " -v " + home + "dk_manager/deplayers:/home/deplayers:ro";
+    cmd += " --network host --entrypoint sleep " + QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) + "/dk_app_python_template:baseimage infinity";
+    cmd += " > /dev/null";
+    qDebug() << cmd;
+    return system(cmd.toUtf8()) == 0;
+}
@@ -0,0 +1,46 @@
+#ifndef CONTAINER_POOL_H
+#define CONTAINER_POOL_H
+
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+
+// Keeps a few idle dk_app_python_template containers ready to run a prototype.
+// Pool containers are created with the shared vehicle_gen / python-packages mounts and an empty staging
+// folder DK_POOL_FOLDER/<container> at /app/exec, and only sleep. Starting an app moves the files of
+// prototypes/<id> into the staging folder, links prototypes/<id> to it, renames the container to the app id
+// and execs main.py, so a "Run" doesn't pay container creation. The pool is refilled in the background.
+class ContainerPool
+{
+public:
+    static ContainerPool *instance();
+
+    // Remove pool containers left over by a previous dk_manager and fill the pool (DK_CONTAINER_POOL_SIZE, default 2).
+    void Init();
+    // Start app_id in a warm container. Returns 0 on success, -1 if the pool is empty or the
+    // warm start failed; the caller then falls back to a regular docker run.
+    int StartApp(const QString &app_id);
+    // Restart main.py inside the warm container running app_id, the container and its mounts stay.
+    // Returns -1 if app_id doesn't run in a pool container.
+    int RestartApp(const QString &app_id);
+    // After the container of app_id is removed: move the app's files back to prototypes/<id>.
+    // Nothing to do if app_id wasn't started from the pool.
+    void ReleaseApp(const QString &app_id);
+
+private:
+    ContainerPool();
+    bool Acquire(QString &container);
+    void Refill();
+    bool CreateContainer(const QString &container);
+    bool Stage(const QString &container, const QString &app_id);
+    static bool IsPoolContainer(const QString &name);
+    static QString LaunchCmd(const QString &app_id);
+
+    QMutex m_mutex;
+    QStringList m_idle;
+    int m_size = 0;
+    int m_nextId = 0;
+    bool m_refilling = false;
+};
+
+#endif // CONTAINER_POOL_H
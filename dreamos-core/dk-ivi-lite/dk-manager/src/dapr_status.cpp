@@ -0,0 +1,210 @@
+#include "dapr_status.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+#include "common_utils.h"
+
+namespace
+{
+const qint64 kDaprStatusMaxAgeMs = 1000;
+const int kDaprMetadataTimeoutMs = 300;
+
+QMutex daprStatusMutex;
+QElapsedTimer daprStatusAge;
+QList<DaprSidecarStatus> daprStatusCache;
+bool daprStatusOk = false;
+}
+
+bool DaprStatusProvider::Discover(QList<DaprSidecarStatus> &sidecars)
+{
+    QString out;
+    try
+    {
+        out = QString::fromStdString(CommonUtils::runLinuxCommand("dapr list -o json 2>&1")).trimmed();
+    }
+    catch (const std::exception &e)
+    {
+        qDebug() << __func__ << __LINE__ << e.what();
+        return false;
+    }
+    if (out.startsWith("No Dapr instances found"))
+    {
+        return true;
+    }
+    // skip anything the CLI printed before the json (warnings go to the same stream)
+    int start = out.indexOf('[');
+    if (start > 0)
+    {
+        out = out.mid(start);
+    }
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(out.toUtf8(), &error);
+    if ((error.error != QJsonParseError::NoError) || !doc.isArray())
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot read dapr list : " << out.left(200);
+        return false;
+    }
+    for (const auto entry : doc.array())
+    {
+        QJsonObject obj = entry.toObject();
+        DaprSidecarStatus sidecar;
+        sidecar.appId = obj.value("appId").toString();
+        sidecar.httpPort = obj.value("httpPort").toInt();
+        sidecar.appPort = obj.value("appPort").toInt();
+        sidecar.runtimeVersion = obj.value("runtimeVersion").toString();
+        if (!sidecar.appId.isEmpty())
+        {
+            sidecars.append(sidecar);
+        }
+    }
+    return true;
+}
+
+QList<int> DaprStatusProvider::ExtraPorts()
+{
+    QList<int> ports;
+    QString spec = qgetenv("DK_DAPR_HTTP_PORTS");
+    for (const QString &part : spec.split(',', Qt::SkipEmptyParts))
+    {
+        QStringList range = part.trimmed().split('-');
+        int first = range[0].toInt();
+        int last = (range.size() > 1) ? range[1].toInt() : first;
+        for (int port = first; (port > 0) && (port <= last) && (port < 65536); port++)
+        {
+            ports.append(port);
+        }
+    }
+    return ports;
+}
+
+QList<DaprSidecarStatus> DaprStatusProvider::Fetch(const QList<DaprSidecarStatus> &candidates)
+{
+    // ask all sidecars at once and wait for the answers, bounded by the timeout
+    QNetworkAccessManager nam;
+    QList<QNetworkReply *> replies;
+    for (const DaprSidecarStatus &candidate : candidates)
+    {
+        QNetworkRequest req(QUrl(QString("http://127.0.0.1:%1/v1.0/metadata").arg(candidate.httpPort)));
+        req.setTransferTimeout(kDaprMetadataTimeoutMs);
+        replies.append(nam.get(req));
+    }
+
+    QEventLoop loop;
+    QTimer timeoutTimer;
+    timeoutTimer.setSingleShot(true);
+    QObject::connect(&timeoutTimer, &QTimer::timeout, &loop, &QEventLoop::quit);
+    int pending = replies.size();
+    for (QNetworkReply *reply : replies)
+    {
+        QObject::connect(reply, &QNetworkReply::finished, &loop, [&pending, &loop]() {
+            if (--pending == 0)
+            {
+                loop.quit();
+            }
+        });
+    }
+    if (pending > 0)
+    {
+        timeoutTimer.start(kDaprMetadataTimeoutMs + 100);
+        loop.exec();
+    }
+
+    QList<DaprSidecarStatus> sidecars;
+    for (int i = 0; i < replies.size(); i++)
+    {
+        QNetworkReply *reply = replies[i];
+        DaprSidecarStatus sidecar = candidates[i];
+        if (reply->isFinished() && (reply->error() == QNetworkReply::NoError))
+        {
+            QJsonObject metadata = QJsonDocument::fromJson(reply->readAll()).object();
+            QJsonObject appConnection = metadata.value("appConnectionProperties").toObject();
+            QString appId = metadata.value("id").toString();
+            if (!appId.isEmpty())
+            {
+                sidecar.appId = appId;
+                sidecar.appPort = appConnection.value("port").toInt();
+                sidecar.appProtocol = appConnection.value("protocol").toString();
+                sidecar.runtimeVersion = metadata.value("runtimeVersion").toString();
+                sidecar.components = metadata.value("components").toArray().size();
+                sidecar.healthy = true;
+            }
+        }
+        else
+        {
+            reply->abort();
+        }
+        // listed by dapr but not answering: still running as far as dapr knows
+        if (!sidecar.appId.isEmpty())
+        {
+            sidecars.append(sidecar);
+        }
+    }
+    return sidecars;
+}
+
+QList<DaprSidecarStatus> DaprStatusProvider::Query(bool *ok)
+{
+    QMutexLocker locker(&daprStatusMutex);
+    if (!daprStatusAge.isValid() || (daprStatusAge.elapsed() >= kDaprStatusMaxAgeMs))
+    {
+        QList<DaprSidecarStatus> candidates;
+        daprStatusOk = Discover(candidates);
+        for (int port : ExtraPorts())
+        {
+            bool known = false;
+            for (const DaprSidecarStatus &candidate : candidates)
+            {
+                known = known || (candidate.httpPort == port);
+            }
+            if (!known)
+            {
+                DaprSidecarStatus candidate;
+                candidate.httpPort = port;
+                candidates.append(candidate);
+            }
+        }
+        daprStatusCache = Fetch(candidates);
+        daprStatusAge.start();
+    }
+    if (ok)
+    {
+        *ok = daprStatusOk;
+    }
+    return daprStatusCache;
+}
+
+QJsonArray DaprStatusProvider::ToJson(const QList<DaprSidecarStatus> &sidecars)
+{
+    QJsonArray list;
+    for (const DaprSidecarStatus &sidecar : sidecars)
+    {
+        QJsonObject obj;
+        obj["appId"] = sidecar.appId;
+        obj["httpPort"] = sidecar.httpPort;
+        obj["appPort"] = sidecar.appPort;
+        obj["appProtocol"] = sidecar.appProtocol;
+        obj["runtimeVersion"] = sidecar.runtimeVersion;
+        obj["components"] = sidecar.components;
+        obj["healthy"] = sidecar.healthy;
+        list.append(obj);
+    }
+    return list;
+}
+
+QString DaprStatusProvider::ToText(const QList<DaprSidecarStatus> &sidecars)
+{
+    QString text = QString("%1%2%3%4\n").arg("APP ID", -24).arg("HTTP PORT", -12).arg("APP PORT", -12).arg("RUNTIME VERSION");
+    for (const DaprSidecarStatus &sidecar : sidecars)
+    {
+        text += QString("%1%2%3%4\n").arg(sidecar.appId, -24).arg(sidecar.httpPort, -12).arg(sidecar.appPort, -12).arg(sidecar.runtimeVersion);
+    }
+    return text;
+}
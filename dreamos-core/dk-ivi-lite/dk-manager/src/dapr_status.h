@@ -0,0 +1,40 @@
+#ifndef DAPR_STATUS_H
+#define DAPR_STATUS_H
+
+#include <QString>
+#include <QList>
+#include <QJsonArray>
+
+struct DaprSidecarStatus
+{
+    QString appId;
+    int httpPort = 0;
+    int appPort = 0;
+    QString appProtocol;
+    QString runtimeVersion;
+    int components = 0;
+    bool healthy = false;
+};
+
+// Reads the status of the local dapr sidecars from their HTTP metadata API (GET /v1.0/metadata)
+// instead of parsing the `dapr list` table. The sidecars are enumerated with one `dapr list -o json`
+// (app sidecars run on random HTTP ports); DK_DAPR_HTTP_PORTS (e.g. "3500,3501-3510") adds ports
+// to probe on top, so tools/mock_dapr_sidecar.py can stand in for a sidecar.
+// A sidecar that is listed but does not answer its metadata API is reported with healthy = false.
+// Results are shared between callers for a short time.
+class DaprStatusProvider
+{
+public:
+    // ok, if set, is false when the sidecars could not be enumerated; the list is incomplete then.
+    static QList<DaprSidecarStatus> Query(bool *ok = nullptr);
+    static QJsonArray ToJson(const QList<DaprSidecarStatus> &sidecars);
+    // Table in the spirit of `dapr list`, for clients that still display the raw text.
+    static QString ToText(const QList<DaprSidecarStatus> &sidecars);
+
+private:
+    static bool Discover(QList<DaprSidecarStatus> &sidecars);
+    static QList<int> ExtraPorts();
+    static QList<DaprSidecarStatus> Fetch(const QList<DaprSidecarStatus> &candidates);
+};
+
+#endif // DAPR_STATUS_H
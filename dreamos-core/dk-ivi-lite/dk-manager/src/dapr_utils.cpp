@@ -1,6 +1,9 @@
 #include "dapr_utils.h"
 #include "fileutils.h"
 #include "common_utils.h"
+#include "container_pool.h"
+#include "zygote_runner.h"
+#include "dependency_layers.h"
 #include <QFile>
 #include <QDebug>
 #include <QThread>
@@ -14,6 +17,9 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QRandomGenerator>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
 
 extern std::string DK_VCU_USERNAME;
 extern std::string DK_ARCH;
@@ -30,12 +36,20 @@ Dapr_Utils::Dapr_Utils(QString dapr_dir, QString proto_dir, QString _log_dir)
 int Dapr_Utils::stopApp(QString app_id) {
     if(app_id.length()<=0) return -1;
 
+    if (ZygoteRunner::Enabled() && (ZygoteRunner::instance()->StopApp(app_id) == 0))
+    {
+        // ran as a fork of the zygote, there is no container of it
+        return 0;
+    }
+
     QString cmd;
     cmd.clear();
 
     cmd += "docker stop " + app_id + "; docker rm " + app_id + ";";
     qDebug() << cmd;
-    return system(cmd.toUtf8());
+    int ret = system(cmd.toUtf8());
+    ContainerPool::instance()->ReleaseApp(app_id);
+    return ret;
 }
 
 int Dapr_Utils::startApp(QString app_id) {
@@ -44,58 +58,234 @@ int Dapr_Utils::startApp(QString app_id) {
     // try to stop app before start
     this->stopApp(app_id);
 
+    if (ZygoteRunner::Enabled() && (ZygoteRunner::instance()->StartApp(app_id) == 0))
+    {
+        return 0;
+    }
+
+    if (ContainerPool::instance()->StartApp(app_id) == 0)
+    {
+        return 0;
+    }
+
     QString cmd;
     cmd.clear();
 
     // docker run -d -it --name giWROQ6WzQcJOkEd3OFn --log-opt max-size=10m --log-opt max-file=3 -v ~/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v ~/.dk/dk_app_python_template/target/amd64/python-packages:/home/python-packages:ro --network host -v ~/.dk/dk_manager/prototypes/giWROQ6WzQcJOkEd3OFn:/app/exec phongbosch/dk_app_python_template:baseimage
     // cmd += "docker run -d -it --name " + app_id + " --log-opt max-size=10m --log-opt max-file=3 -v /app/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /app/.dk/dk_app_python_template/target/amd64/python-packages:/home/python-packages:ro --network host -v /app/.dk/dk_manager/prototypes/" + app_id + ":/app/exec dk_app_python_template:baseimage";
-    cmd += "docker run -d -it --name " + app_id + " --log-opt max-size=10m --log-opt max-file=3 -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro --network host -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/prototypes/" + app_id + ":/app/exec " + QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) +"/dk_app_python_template:baseimage";
+    cmd += "docker run -d -it --name " + app_id + " --log-opt max-size=10m --log-opt max-file=3 -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro --network host -v /home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/prototypes/" + app_id + ":/app/exec ";
+    QString layer = DependencyLayerCache::instance()->ReadyLayerOf(app_id);
+    if (!layer.isEmpty())
+    {
+        // the prototype's own packages go in front of the shared ones
+        cmd += "-v " + DependencyLayerCache::HostPath("") + ":/home/deplayers:ro -e PYTHONPATH=" + DependencyLayerCache::ContainerPath(layer) + ":/home/python-packages ";
+    }
+    cmd += QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) +"/dk_app_python_template:baseimage";
     // cmd += "python3 main.py  > main.log 2>&1 &";
     qDebug() << cmd;
     return system(cmd.toUtf8());
 }
 
-QString Dapr_Utils::daprCliList() {
-    QString cmd;
-    QString listcmdlogFile = this->_log_dir + "listcmd.log";
+int Dapr_Utils::reloadApp(QString app_id) {
+    if(app_id.length()<=0) return -1;
 
-    cmd.clear();
-    cmd += "dapr list > " + listcmdlogFile;
+    if (ZygoteRunner::Enabled() && ZygoteRunner::instance()->RunningApps().contains(app_id))
+    {
+        // the zygote stops the old fork before it forks again
+        return ZygoteRunner::instance()->StartApp(app_id);
+    }
+
+    if (!this->runningDockerApps().contains(app_id))
+    {
+        return 1;
+    }
+
+    // warm containers: restart only the interpreter
+    if (ContainerPool::instance()->RestartApp(app_id) == 0)
+    {
+        return 0;
+    }
+
+    // the template entrypoint owns the interpreter, restart the existing container (same mounts, no docker run)
+    QString cmd = "docker restart -t 2 " + app_id;
     qDebug() << cmd;
-    system(cmd.toUtf8());
+    return system(cmd.toUtf8());
+}
 
-    QThread::msleep(10);
-    QString rawDaprRunStatus = FileUtils::ReadFile(listcmdlogFile);
+QList<DaprSidecarStatus> Dapr_Utils::daprStatus() {
+    return DaprStatusProvider::Query();
+}
 
-    qDebug() << "Result";
-    qDebug() << rawDaprRunStatus;
+QStringList Dapr_Utils::listPrototypeIds() {
+    QStringList ids;
+    QString prototypes_file_path = this->_proto_dir + "prototypes.json";
+    QJsonArray jsonAppList = QJsonDocument::fromJson(FileUtils::ReadFile(prototypes_file_path).toUtf8()).array();
+    for (const auto obj : jsonAppList)
+    {
+        QString appId = obj.toObject().value("id").toString();
+        if (!appId.isEmpty())
+        {
+            ids.append(appId);
+        }
+    }
+    return ids;
+}
 
-    cmd.clear();
-    cmd += "> " + listcmdlogFile;
-    system(cmd.toUtf8());
-    return rawDaprRunStatus;
+QSet<QString> Dapr_Utils::runningDockerApps() {
+    QSet<QString> names;
+    try
+    {
+        QString out = QString::fromStdString(CommonUtils::runLinuxCommand("docker ps --format '{{.Names}}' 2>/dev/null"));
+        for (const QString &name : out.split('\n', Qt::SkipEmptyParts))
+        {
+            names.insert(name.trimmed());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        qDebug() << __func__ << __LINE__ << e.what();
+    }
+    return names;
+}
+
+QSet<QString> Dapr_Utils::runningDaprApps(bool *ok) {
+    QSet<QString> ids;
+    for (const DaprSidecarStatus &sidecar : DaprStatusProvider::Query(ok))
+    {
+        ids.insert(sidecar.appId);
+    }
+    return ids;
+}
+
+QList<AppOpResult> Dapr_Utils::runBulk(const QStringList &app_ids, int parallelism, std::function<AppOpResult(const QString &)> op) {
+    // every task writes only its own slot, so no locking is needed
+    QList<AppOpResult> results(app_ids.size());
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, parallelism));
+    for (int i = 0; i < app_ids.size(); i++)
+    {
+        QString appId = app_ids[i];
+        AppOpResult *slot = &results[i];
+        pool.start(QRunnable::create([appId, slot, op]() {
+            QElapsedTimer timer;
+            timer.start();
+            *slot = op(appId);
+            slot->appId = appId;
+            slot->elapsedMs = timer.elapsed();
+        }));
+    }
+    pool.waitForDone();
+    return results;
+}
+
+QList<AppOpResult> Dapr_Utils::stopApps(const QStringList &app_ids, int parallelism) {
+    // one snapshot of what is running instead of a blind stop per app
+    QSet<QString> dockerApps = this->runningDockerApps();
+    bool daprKnown = true;
+    QSet<QString> daprApps = this->runningDaprApps(&daprKnown);
+    if (!daprKnown)
+    {
+        qDebug() << __func__ << __LINE__ << " : dapr sidecars unknown, stopping every app through dapr";
+    }
+    if (ZygoteRunner::Enabled())
+    {
+        // stopApp() stops zygote forks as well
+        dockerApps.unite(ZygoteRunner::instance()->RunningApps());
+    }
+
+    QList<AppOpResult> results = this->runBulk(app_ids, parallelism, [this, dockerApps, daprApps, daprKnown](const QString &appId) {
+        AppOpResult result;
+        bool inDocker = dockerApps.contains(appId);
+        // without a snapshot an app may still run under dapr, never skip it then
+        bool inDapr = !daprKnown || daprApps.contains(appId);
+        if (!inDocker && !inDapr)
+        {
+            result.skipped = true;
+            return result;
+        }
+        if (inDapr)
+        {
+            QString cmd = "dapr stop " + appId;
+            qDebug() << cmd;
+            result.exitCode = system(cmd.toUtf8());
+        }
+        if (inDocker)
+        {
+            int ret = this->stopApp(appId);
+            if (result.exitCode == 0)
+            {
+                result.exitCode = ret;
+            }
+        }
+        return result;
+    });
+
+    for (const AppOpResult &result : results)
+    {
+        qDebug() << __func__ << __LINE__ << result.appId << (result.skipped ? "skipped" : "stopped")
+                 << " exitCode : " << result.exitCode << " elapsedMs : " << result.elapsedMs;
+    }
+    return results;
+}
+
+QList<AppOpResult> Dapr_Utils::startApps(const QStringList &app_ids, int parallelism) {
+    QList<AppOpResult> results = this->runBulk(app_ids, parallelism, [this](const QString &appId) {
+        AppOpResult result;
+        if (!QFileInfo::exists(this->_proto_dir + appId + "/main.py"))
+        {
+            // not deployed on this kit
+            result.skipped = true;
+            result.exitCode = -1;
+            return result;
+        }
+        result.exitCode = this->startApp(appId);
+        return result;
+    });
+
+    for (const AppOpResult &result : results)
+    {
+        qDebug() << __func__ << __LINE__ << result.appId << (result.skipped ? "skipped" : "started")
+                 << " exitCode : " << result.exitCode << " elapsedMs : " << result.elapsedMs;
+    }
+    return results;
+}
+
+QJsonArray Dapr_Utils::toJson(const QList<AppOpResult> &results) {
+    QJsonArray list;
+    for (const AppOpResult &result : results)
+    {
+        QJsonObject obj;
+        obj["id"] = result.appId;
+        if (result.skipped)
+        {
+            obj["result"] = "skipped";
+        }
+        else
+        {
+            obj["result"] = (result.exitCode == 0) ? "success" : "failed";
+        }
+        obj["exitCode"] = result.exitCode;
+        obj["elapsedMs"] = result.elapsedMs;
+        list.append(obj);
+    }
+    return list;
 }
 
 int Dapr_Utils::stopAllApp() {
     qDebug() << "stop all dapr digital.auto apps and the apps based on velocitas";
-    QString prototypes_file_path = this->_log_dir + "prototypes.json";
-    QFile file(prototypes_file_path);
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
-    if (file.isOpen())
-    {
-        QString data = QString(file.readAll());
-        file.close();
-        //        qDebug() << "raw file: " << data;
-        QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
-        for (const auto obj : jsonAppList)
+    QString prototypes_file_path = this->_proto_dir + "prototypes.json";
+    if (!QFileInfo::exists(prototypes_file_path))
+    {
+        return -1;
+    }
+
+    int failed = 0;
+    for (const AppOpResult &result : this->stopApps(this->listPrototypeIds()))
+    {
+        if (!result.skipped && (result.exitCode != 0))
         {
-            QString appId = obj.toObject().value("id").toString();
-            std::string cmd = "dapr stop " + appId.toStdString();
-            qDebug() << "dapr cmd : " << QString::fromStdString(cmd);
-            std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
+            failed++;
         }
-    } else {
-        return -1;
     }
-    return 0;
+    return failed;
 }
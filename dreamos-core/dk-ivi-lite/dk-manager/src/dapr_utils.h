@@ -5,6 +5,21 @@
 #include <QDebug>
 #include <QThread>
 #include <QFile>
+#include <QSet>
+#include <QList>
+#include <QStringList>
+#include <QJsonArray>
+#include <functional>
+#include "dapr_status.h"
+
+// Per-app outcome of a bulk lifecycle operation.
+struct AppOpResult
+{
+    QString appId;
+    bool skipped = false;
+    int exitCode = 0;
+    qint64 elapsedMs = 0;
+};
 
 class Dapr_Utils: public QObject
 {
@@ -14,12 +29,25 @@ private:
     QString _proto_dir;
     QString _app_args;
     QString _log_dir;
+    QList<AppOpResult> runBulk(const QStringList &app_ids, int parallelism, std::function<AppOpResult(const QString &)> op);
 public:
     Dapr_Utils(QString dapr_dir, QString proto_dir, QString _log_dir);
     int stopApp(QString app_id);
     int startApp(QString app_id);
+    // Pick up new code of a running app without recreating its container.
+    // Returns 0 when reloaded, 1 when the app isn't running, otherwise the failing exit code.
+    int reloadApp(QString app_id);
     int stopAllApp();
-    QString daprCliList();
+    QList<DaprSidecarStatus> daprStatus();
+
+    // Bulk lifecycle: run with bounded parallelism, one result per requested app.
+    QStringList listPrototypeIds();
+    QSet<QString> runningDockerApps();
+    // ok, if set, is false when the running sidecars could not be enumerated
+    QSet<QString> runningDaprApps(bool *ok = nullptr);
+    QList<AppOpResult> stopApps(const QStringList &app_ids, int parallelism = 8);
+    QList<AppOpResult> startApps(const QStringList &app_ids, int parallelism = 4);
+    static QJsonArray toJson(const QList<AppOpResult> &results);
 };
 
 #endif // DAPR_UTILS_H
@@ -0,0 +1,337 @@
+#include "databroker_supervisor.h"
+#include "common_utils.h"
+#include <QDebug>
+#include <QTcpSocket>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QDeadlineTimer>
+
+extern std::string DK_VCU_USERNAME;
+extern std::string DK_DATABROKER_LOG;
+extern std::string DK_VSS_VSPECS_JSON;
+extern std::string DK_LOG_FOLDER;
+extern std::string DK_STARTKUKFEEDER_SCRIPT;
+extern std::string DK_STOPKUKFEEDER_SCRIPT;
+
+namespace
+{
+const quint16 DATABROKER_PORT = 55555;
+const int PROBE_INTERVAL_MS = 1000;
+const int PROBE_TIMEOUT_MS = 500;
+const int PROBE_FAILURES_TO_DOWN = 3;
+// a freshly launched broker (dapr sidecar + container) needs a moment before it listens
+const int STARTUP_GRACE_MS = 15000;
+const int BACKOFF_INITIAL_MS = 2000;
+const int BACKOFF_MAX_MS = 30000;
+}
+
+DatabrokerSupervisor *DatabrokerSupervisor::instance()
+{
+    // never destroyed: the probe thread runs until the process exits
+    static DatabrokerSupervisor *supervisor = new DatabrokerSupervisor();
+    return supervisor;
+}
+
+DatabrokerSupervisor::DatabrokerSupervisor()
+{
+    m_probeTimer = new QTimer();
+    m_probeTimer->setInterval(PROBE_INTERVAL_MS);
+    m_probeTimer->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::started, m_probeTimer, QOverload<>::of(&QTimer::start));
+    connect(m_probeTimer, &QTimer::timeout, this, &DatabrokerSupervisor::Probe);
+    this->moveToThread(&m_thread);
+}
+
+void DatabrokerSupervisor::Init(DkOrchestrator *orchestrator)
+{
+    SetOrchestrator(orchestrator);
+    if (m_thread.isRunning())
+    {
+        return;
+    }
+
+    // the broker may survive a dk_manager restart, take it over if it already answers
+    if (ProbeOnce())
+    {
+        qDebug() << __func__ << __LINE__ << " : vehicledatabroker is already running, supervise it";
+        QMutexLocker locker(&m_mutex);
+        m_state = Healthy;
+    }
+    m_thread.start();
+}
+
+void DatabrokerSupervisor::SetOrchestrator(DkOrchestrator *orchestrator)
+{
+    QMutexLocker locker(&m_mutex);
+    m_orchestrator = orchestrator;
+}
+
+bool DatabrokerSupervisor::StartBroker(int timeoutMs)
+{
+    {
+        QMutexLocker lifecycle(&m_lifecycleMutex);
+        {
+            QMutexLocker locker(&m_mutex);
+            m_state = Starting;
+            m_failedProbes = 0;
+            m_backoffMs = BACKOFF_INITIAL_MS;
+            m_sinceLastRestart.start();
+        }
+        LaunchBroker();
+    }
+
+    QDeadlineTimer deadline(timeoutMs);
+    QMutexLocker locker(&m_mutex);
+    while (m_state != Healthy)
+    {
+        if (!m_healthChanged.wait(&m_mutex, deadline))
+        {
+            qDebug() << __func__ << __LINE__ << " : vehicledatabroker is not reachable after " << timeoutMs << " ms";
+            return false;
+        }
+    }
+    return true;
+}
+
+void DatabrokerSupervisor::StopBroker()
+{
+    QMutexLocker lifecycle(&m_lifecycleMutex);
+    {
+        QMutexLocker locker(&m_mutex);
+        m_state = Unsupervised;
+        m_failedProbes = 0;
+    }
+    KillBroker();
+}
+
+void DatabrokerSupervisor::StartFeeders()
+{
+    bool startNow = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_feedersWanted = true;
+        if ((m_state == Healthy) && !m_feedersRunning)
+        {
+            m_feedersRunning = true;
+            startNow = true;
+        }
+    }
+    if (startNow)
+    {
+        RunFeederScript(true);
+    }
+    else
+    {
+        qDebug() << __func__ << __LINE__ << " : feeders start once vehicledatabroker is up";
+    }
+}
+
+void DatabrokerSupervisor::StopFeeders()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_feedersWanted = false;
+        m_feedersRunning = false;
+    }
+    RunFeederScript(false);
+}
+
+bool DatabrokerSupervisor::IsHealthy()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_state == Healthy;
+}
+
+QJsonObject DatabrokerSupervisor::GetMetrics()
+{
+    static const char *stateNames[] = {"unsupervised", "starting", "healthy", "down"};
+
+    QMutexLocker locker(&m_mutex);
+    int recoveries = m_restarts;
+    QJsonObject obj;
+    obj["state"] = stateNames[m_state];
+    obj["feeders_running"] = m_feedersRunning;
+    obj["crashes"] = m_crashes;
+    obj["recoveries"] = recoveries;
+    obj["last_recovery_ms"] = m_lastRecoveryMs;
+    obj["max_recovery_ms"] = m_maxRecoveryMs;
+    obj["avg_recovery_ms"] = (recoveries > 0) ? (m_totalRecoveryMs / recoveries) : -1;
+    obj["down_for_ms"] = (m_state == Down) ? m_downSince.elapsed() : 0;
+    return obj;
+}
+
+bool DatabrokerSupervisor::ProbeOnce()
+{
+    // dk_manager carries no gRPC stack, so health means "accepts connections on the broker port".
+    // A crashed or stopped container (or a broker stuck before bind) fails this check.
+    QTcpSocket socket;
+    socket.connectToHost("127.0.0.1", DATABROKER_PORT);
+    bool ok = socket.waitForConnected(PROBE_TIMEOUT_MS);
+    socket.abort();
+    return ok;
+}
+
+void DatabrokerSupervisor::Probe()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_state == Unsupervised)
+        {
+            return;
+        }
+    }
+
+    bool ok = ProbeOnce();
+
+    bool recovered = false;
+    bool startFeeders = false;
+    bool stopFeeders = false;
+    bool restart = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_state == Unsupervised)
+        {
+            // StopBroker() raced with this probe
+            return;
+        }
+
+        if (ok)
+        {
+            m_failedProbes = 0;
+            if (m_state != Healthy)
+            {
+                if (m_state == Down)
+                {
+                    qint64 recoveryMs = m_downSince.elapsed();
+                    m_restarts++;
+                    m_lastRecoveryMs = recoveryMs;
+                    m_maxRecoveryMs = qMax(m_maxRecoveryMs, recoveryMs);
+                    m_totalRecoveryMs += recoveryMs;
+                    recovered = true;
+                    qDebug() << __func__ << __LINE__ << " : vehicledatabroker recovered after " << recoveryMs << " ms";
+                }
+                m_state = Healthy;
+                m_backoffMs = BACKOFF_INITIAL_MS;
+                m_healthChanged.wakeAll();
+                if (m_feedersWanted && !m_feedersRunning)
+                {
+                    m_feedersRunning = true;
+                    startFeeders = true;
+                }
+            }
+        }
+        else if (m_state == Healthy)
+        {
+            m_failedProbes++;
+            if (m_failedProbes >= PROBE_FAILURES_TO_DOWN)
+            {
+                qDebug() << __func__ << __LINE__ << " : vehicledatabroker is down, restart it";
+                m_state = Down;
+                m_crashes++;
+                m_downSince.start();
+                m_backoffMs = BACKOFF_INITIAL_MS;
+                stopFeeders = m_feedersRunning;
+                m_feedersRunning = false;
+                restart = true;
+            }
+        }
+        else if (m_state == Starting)
+        {
+            if (m_sinceLastRestart.elapsed() > STARTUP_GRACE_MS)
+            {
+                qDebug() << __func__ << __LINE__ << " : vehicledatabroker did not come up, restart it";
+                m_state = Down;
+                m_downSince.start();
+                restart = true;
+            }
+        }
+        else if (m_sinceLastRestart.elapsed() >= m_backoffMs)
+        {
+            m_backoffMs = qMin(m_backoffMs * 2, BACKOFF_MAX_MS);
+            restart = true;
+        }
+    }
+
+    if (stopFeeders)
+    {
+        RunFeederScript(false);
+    }
+    if (restart)
+    {
+        QMutexLocker lifecycle(&m_lifecycleMutex);
+        {
+            // StopBroker() may have run since the restart was decided
+            QMutexLocker locker(&m_mutex);
+            restart = (m_state != Unsupervised);
+        }
+        if (restart)
+        {
+            KillBroker();
+            LaunchBroker();
+            QMutexLocker locker(&m_mutex);
+            m_sinceLastRestart.start();
+        }
+    }
+    if (startFeeders)
+    {
+        RunFeederScript(true);
+    }
+    if (recovered || restart)
+    {
+        PublishMetrics();
+    }
+}
+
+void DatabrokerSupervisor::LaunchBroker()
+{
+    qDebug() << "start vehicledatabroker on vcu";
+    std::string cmd = "> " + DK_DATABROKER_LOG + ";";
+    cmd += "sudo -u " + DK_VCU_USERNAME + " dapr run --app-id vehicledatabroker --app-protocol grpc --dapr-http-port 3500 --resources-path /home/" + DK_VCU_USERNAME + "/.dapr/components --config /home/" + DK_VCU_USERNAME + "/.dapr/config.yaml --app-port 55555 -- docker run --rm --init --name vehicledatabroker -e KUKSA_DATA_BROKER_METADATA_FILE=" + DK_VSS_VSPECS_JSON + " -e KUKSA_DATA_BROKER_PORT=55555 -e 50001 -e 3500 -v " + DK_VSS_VSPECS_JSON + ":" + DK_VSS_VSPECS_JSON + " --network host ghcr.io/eclipse/kuksa.val/databroker:0.3.0 > ";
+    cmd += DK_DATABROKER_LOG + " 2>&1 &";
+    qDebug() << "vehicledatabroker cmd : " << QString::fromStdString(cmd);
+    system(cmd.c_str());
+}
+
+void DatabrokerSupervisor::KillBroker()
+{
+    qDebug() << "stop vehicledatabroker on vcu";
+    // rm -f returns once the container is gone, no need to sleep for docker stop
+    CommonUtils::runLinuxCommand("docker rm -f vehicledatabroker");
+    CommonUtils::runLinuxCommand("dapr stop vehicledatabroker");
+}
+
+void DatabrokerSupervisor::RunFeederScript(bool start)
+{
+    DkOrchestrator *orchestrator = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        orchestrator = m_orchestrator;
+    }
+
+    if (orchestrator)
+    {
+        qDebug() << "------ Send cmd to " << (start ? "start" : "stop") << " kuksa-feeder on zonecontroller";
+        orchestrator->SendCmd("zonecontroller", start ? "start_kuksa_feeder_script" : "stop_kuksa_feeder_script");
+    }
+#ifdef DREAMKIT_MINI
+    else
+    {
+        const std::string &script = start ? DK_STARTKUKFEEDER_SCRIPT : DK_STOPKUKFEEDER_SCRIPT;
+        qDebug() << __func__ << __LINE__ << ": " << QString::fromStdString(script) << " ret : " <<
+        QString::fromStdString(CommonUtils::runLinuxCommand(script.c_str()));
+    }
+#endif
+}
+
+void DatabrokerSupervisor::PublishMetrics()
+{
+    QSaveFile file(QString::fromStdString(DK_LOG_FOLDER + "databroker_metrics.json"));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(GetMetrics()).toJson());
+    file.commit();
+}
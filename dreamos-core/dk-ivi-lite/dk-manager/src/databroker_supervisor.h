@@ -0,0 +1,83 @@
+#ifndef DATABROKER_SUPERVISOR_H
+#define DATABROKER_SUPERVISOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include "vcuorchestrator.hpp"
+
+// Owns the lifecycle of vehicledatabroker and the kuksa feeders that depend on it.
+// Once dk_manager started the broker, its gRPC port is probed continuously on a dedicated thread.
+// When the broker goes down the feeders are stopped, the broker is restarted with exponential
+// backoff, and the feeders are started again after the broker answers. Crash-to-recovery times
+// are kept as metrics (GetMetrics(), DK_LOG_FOLDER/databroker_metrics.json).
+class DatabrokerSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DatabrokerSupervisor *instance();
+
+    void Init(DkOrchestrator *orchestrator);
+    void SetOrchestrator(DkOrchestrator *orchestrator);
+
+    // Launch the broker, supervise it and wait until it answers (or timeoutMs elapsed).
+    bool StartBroker(int timeoutMs = 10000);
+    // Stop supervising and stop the broker, e.g. while the vss mapping is redeployed.
+    void StopBroker();
+    // Start the feeders now if the broker is up, otherwise as soon as it is.
+    void StartFeeders();
+    void StopFeeders();
+
+    bool IsHealthy();
+    QJsonObject GetMetrics();
+
+private Q_SLOTS:
+    void Probe();
+
+private:
+    enum State
+    {
+        Unsupervised,
+        Starting,
+        Healthy,
+        Down
+    };
+
+    DatabrokerSupervisor();
+    bool ProbeOnce();
+    void LaunchBroker();
+    void KillBroker();
+    void RunFeederScript(bool start);
+    void PublishMetrics();
+
+    QThread m_thread;
+    QTimer *m_probeTimer = nullptr;
+    DkOrchestrator *m_orchestrator = nullptr;
+
+    // Serializes launching and killing the broker (start, stop, restart by the probe), so a
+    // restart decided by the probe cannot relaunch a broker StopBroker() just took down.
+    // Taken before m_mutex, never while holding it.
+    QMutex m_lifecycleMutex;
+    QMutex m_mutex;
+    QWaitCondition m_healthChanged;
+    State m_state = Unsupervised;
+    bool m_feedersWanted = false;
+    bool m_feedersRunning = false;
+    int m_failedProbes = 0;
+    int m_backoffMs = 0;
+    QElapsedTimer m_downSince;
+    QElapsedTimer m_sinceLastRestart;
+
+    int m_crashes = 0;
+    int m_restarts = 0;
+    qint64 m_lastRecoveryMs = -1;
+    qint64 m_maxRecoveryMs = -1;
+    qint64 m_totalRecoveryMs = 0;
+};
+
+#endif // DATABROKER_SUPERVISOR_H
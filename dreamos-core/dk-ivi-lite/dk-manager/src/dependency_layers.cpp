@@ -0,0 +1,269 @@
+#include "dependency_layers.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QDateTime>
+#include <QStringList>
+#include <QCryptographicHash>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <algorithm>
+#include <vector>
+
+extern std::string DK_VCU_USERNAME;
+extern std::string DK_DOCKER_HUB_NAMESPACE;
+extern std::string DK_PROTOTYPES_FOLDER;
+extern std::string DK_DEPLAYERS_FOLDER;
+
+DependencyLayerCache *DependencyLayerCache::instance()
+{
+    static DependencyLayerCache cache;
+    return &cache;
+}
+
+QString DependencyLayerCache::Normalize(const QByteArray &requirements)
+{
+    // pip: a comment starts at a '#' at the beginning of the line or after whitespace (not in "...#egg=")
+    static const QRegularExpression comment("(^|\\s)#.*$");
+    static const QRegularExpression name("^[A-Za-z0-9][A-Za-z0-9._-]*");
+    static const QRegularExpression separators("[-_.]+");
+
+    QStringList lines;
+    for (QString line : QString::fromUtf8(requirements).split('\n'))
+    {
+        line = line.remove(comment).simplified();
+        if (line.isEmpty())
+        {
+            continue;
+        }
+        QRegularExpressionMatch match = name.match(line);
+        if (match.hasMatch() && !line.contains("://"))
+        {
+            // "Foo_Bar >= 1.0 ; python_version < '3.9'" -> "foo-bar>=1.0; python_version < '3.9'"
+            QString rest = line.mid(match.capturedLength());
+            int marker = rest.indexOf(';');
+            QString spec = (marker < 0) ? rest : rest.left(marker);
+            spec.remove(' ');
+            line = match.captured().toLower().replace(separators, "-") + spec + ((marker < 0) ? QString() : "; " + rest.mid(marker + 1).trimmed());
+        }
+        if (!lines.contains(line))
+        {
+            lines.append(line);
+        }
+    }
+    lines.sort();
+    return lines.join('\n');
+}
+
+QString DependencyLayerCache::HashOf(const QString &normalized)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(normalized.toUtf8(), QCryptographicHash::Sha256).toHex());
+}
+
+QString DependencyLayerCache::LayerOf(const QString &app_id)
+{
+    QFile file(QString::fromStdString(DK_PROTOTYPES_FOLDER) + app_id + "/requirements.txt");
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return "";
+    }
+    QString normalized = Normalize(file.readAll());
+    return normalized.isEmpty() ? QString() : HashOf(normalized);
+}
+
+bool DependencyLayerCache::IsReady(const QString &hash)
+{
+    return !hash.isEmpty() && QFileInfo(QString::fromStdString(DK_DEPLAYERS_FOLDER) + hash).isDir();
+}
+
+QString DependencyLayerCache::ReadyLayerOf(const QString &app_id)
+{
+    QString hash = Prepare(app_id);
+    if (!hash.isEmpty() && !IsReady(hash))
+    {
+        qDebug() << __func__ << __LINE__ << " : layer " << hash << " of " << app_id << " is not built, start without it";
+        return "";
+    }
+    if (!hash.isEmpty())
+    {
+        Touch(hash);
+    }
+    return hash;
+}
+
+QString DependencyLayerCache::HostPath(const QString &hash)
+{
+    return "/home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/dk_manager/deplayers/" + hash;
+}
+
+QString DependencyLayerCache::ContainerPath(const QString &hash)
+{
+    return "/home/deplayers/" + hash;
+}
+
+qint64 DependencyLayerCache::DefaultMaxBytes()
+{
+    bool ok = false;
+    qint64 mb = qgetenv("DK_DEPLAYERS_MAX_MB").toLongLong(&ok);
+    if (!ok || (mb <= 0))
+    {
+        mb = 2048;
+    }
+    return mb * 1024 * 1024;
+}
+
+void DependencyLayerCache::Touch(const QString &hash)
+{
+    // used again, keep it away from the eviction
+    QFile file(QString::fromStdString(DK_DEPLAYERS_FOLDER) + hash + ".txt");
+    if (file.open(QIODevice::ReadOnly))
+    {
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    }
+}
+
+void DependencyLayerCache::Trim(const QString &keep_hash)
+{
+    // the layers of the deployed prototypes are mounted on their next start, never remove them
+    QSet<QString> referenced;
+    referenced.insert(keep_hash);
+    QDir prototypes(QString::fromStdString(DK_PROTOTYPES_FOLDER));
+    for (const QString &app_id : prototypes.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        referenced.insert(LayerOf(app_id));
+    }
+
+    struct Entry
+    {
+        QString hash;
+        qint64 size;
+        QDateTime used;
+    };
+    std::vector<Entry> entries;
+    qint64 total = 0;
+    QString root = QString::fromStdString(DK_DEPLAYERS_FOLDER);
+    QDir deplayers(root);
+    for (const QString &hash : deplayers.entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        if (hash.endsWith(".tmp") || hash.endsWith(".evicted"))
+        {
+            continue; // being built or removed
+        }
+        qint64 size = 0;
+        QDirIterator it(root + hash, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+        while (it.hasNext())
+        {
+            it.next();
+            size += it.fileInfo().size();
+        }
+        total += size;
+        if (!referenced.contains(hash))
+        {
+            QFileInfo txt(root + hash + ".txt");
+            entries.push_back({hash, size, txt.exists() ? txt.lastModified() : QFileInfo(root + hash).lastModified()});
+        }
+    }
+    if (total <= DefaultMaxBytes())
+    {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+    for (const Entry &entry : entries)
+    {
+        if (total <= DefaultMaxBytes())
+        {
+            break;
+        }
+        // unpublish first: a half removed layer must not look ready
+        QString trash = root + entry.hash + ".evicted";
+        if (!QDir().rename(root + entry.hash, trash))
+        {
+            continue;
+        }
+        QDir(trash).removeRecursively();
+        QFile::remove(root + entry.hash + ".txt");
+        QFile::remove(root + entry.hash + ".log");
+        total -= entry.size;
+        qDebug() << __func__ << __LINE__ << " : evicted layer " << entry.hash;
+    }
+}
+
+QString DependencyLayerCache::Prepare(const QString &app_id, bool retryFailed)
+{
+    QString hash = LayerOf(app_id);
+    if (hash.isEmpty() || IsReady(hash))
+    {
+        return hash;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (retryFailed)
+        {
+            m_failed.remove(hash);
+        }
+        // a broken requirements set would run pip again on every start of the app otherwise
+        if (m_building.contains(hash) || m_failed.contains(hash))
+        {
+            return hash;
+        }
+        m_building.insert(hash);
+    }
+
+    // keep a copy under the hash: the prototype may be redeployed while the layer is built
+    QString requirementsPath = QString::fromStdString(DK_DEPLAYERS_FOLDER) + hash + ".txt";
+    QFile::remove(requirementsPath);
+    QFile::copy(QString::fromStdString(DK_PROTOTYPES_FOLDER) + app_id + "/requirements.txt", requirementsPath);
+
+    QThreadPool::globalInstance()->start(QRunnable::create([this, hash, requirementsPath]() {
+        bool built = Build(hash, requirementsPath);
+        QMutexLocker locker(&m_mutex);
+        m_building.remove(hash);
+        if (!built)
+        {
+            m_failed.insert(hash);
+        }
+    }));
+    return hash;
+}
+
+bool DependencyLayerCache::Build(const QString &hash, const QString &requirementsPath)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QString root = QString::fromStdString(DK_DEPLAYERS_FOLDER);
+    QString tmpDir = root + hash + ".tmp";
+    QDir(tmpDir).removeRecursively();
+    if (!QDir().mkpath(tmpDir))
+    {
+        qDebug() << __func__ << __LINE__ << " : cannot create " << tmpDir;
+        return false;
+    }
+
+    QString hostRoot = HostPath("");
+    QString cmd = "docker run --rm --network host";
+    cmd += " -v " + hostRoot + hash + ".tmp:/layer";
+    cmd += " -v " + hostRoot + hash + ".txt:/requirements.txt:ro";
+    cmd += " --entrypoint python3 " + QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) + "/dk_app_python_template:baseimage";
+    cmd += " -m pip install --no-cache-dir --disable-pip-version-check --target /layer -r /requirements.txt";
+    cmd += " > " + root + hash + ".log 2>&1";
+    qDebug() << cmd;
+    int ret = system(cmd.toUtf8());
+
+    // publish under the hash only once pip succeeded, a half built layer is never mounted
+    if ((ret != 0) || !QDir().rename(tmpDir, root + hash))
+    {
+        qDebug() << __func__ << __LINE__ << " : layer " << hash << " failed, see " << root + hash + ".log";
+        QDir(tmpDir).removeRecursively();
+        return false;
+    }
+    qDebug() << __func__ << __LINE__ << " : layer " << hash << " built in " << timer.elapsed() << " ms";
+    Trim(hash);
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef DEPENDENCY_LAYERS_H
+#define DEPENDENCY_LAYERS_H
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+// Extra python packages of a prototype, built once per distinct requirements set.
+// A layer is a pip --target folder under DK_DEPLAYERS_FOLDER/<sha256 of the normalized requirements.txt>,
+// so prototypes with the same dependencies share it. Layers are built by a worker thread in a throw-away
+// template container and appear under their hash only when complete.
+// The cache is bounded: once the layers take more than DefaultMaxBytes(), the least recently used ones
+// that no deployed prototype needs any more are removed (a layer's use is the mtime of its <hash>.txt).
+class DependencyLayerCache
+{
+public:
+    static DependencyLayerCache *instance();
+
+    // Sorted, de-duplicated requirement lines without comments and blanks; identical sets hash the same.
+    // Only the package names are normalized (PEP 503), versions, markers, options and URLs are kept as written.
+    static QString Normalize(const QByteArray &requirements);
+    static QString HashOf(const QString &normalized);
+
+    // Hash of prototypes/<app_id>/requirements.txt, empty if the prototype has no extra dependencies.
+    QString LayerOf(const QString &app_id);
+    // Queue the build of the layer of app_id unless it is ready or being built. Returns the layer hash.
+    // A layer that failed to build is not tried again until a deploy asks for it with retryFailed.
+    QString Prepare(const QString &app_id, bool retryFailed = false);
+    bool IsReady(const QString &hash);
+    // Hash of the layer to mount for app_id if it is built, otherwise an empty string (and the build is queued).
+    QString ReadyLayerOf(const QString &app_id);
+    // Folder of the layer as seen by docker on the host, for bind mounts.
+    static QString HostPath(const QString &hash);
+    // Every runner mounts HostPath("") read-only at /home/deplayers, this is the layer's folder in there.
+    static QString ContainerPath(const QString &hash);
+
+    // DK_DEPLAYERS_MAX_MB, 2048 MB if unset
+    static qint64 DefaultMaxBytes();
+
+private:
+    DependencyLayerCache() = default;
+    bool Build(const QString &hash, const QString &requirementsPath);
+    void Touch(const QString &hash);
+    void Trim(const QString &keep_hash);
+
+    QMutex m_mutex;
+    QSet<QString> m_building;
+    QSet<QString> m_failed;
+};
+
+#endif // DEPENDENCY_LAYERS_H
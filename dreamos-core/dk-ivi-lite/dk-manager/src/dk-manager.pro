@@ -23,13 +23,22 @@ QMAKE_CXXFLAGS += -fpermissive
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+        admission_control.cpp \
+        blob_store.cpp \
         common_utils.cpp \
+        container_pool.cpp \
+        dapr_status.cpp \
         dapr_utils.cpp \
+        databroker_supervisor.cpp \
+        dependency_layers.cpp \
+        dk_manager_core.cpp \
         dkmanager.cpp \
         fileutils.cpp \
         message_to_kit_handler.cpp \
         prototype_utils.cpp \
+        response_cache.cpp \
         vcuorchestrator.cpp \
+        zygote_runner.cpp \
         main.cpp
 
 LIBS += -lsioclient_tls -lssl -lcrypto
@@ -41,9 +50,20 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    admission_control.h \
+    blob_store.h \
     common_utils.h \
+    container_pool.h \
+    dapr_status.h \
     dapr_utils.h \
+    databroker_supervisor.h \
+    dependency_layers.h \
+    dk_manager_core.h \
     dkmanager.h \
     fileutils.h \
     message_to_kit_handler.h \
-    prototype_utils.h
+    prototype_utils.h \
+    response_cache.h \
+    zygote_runner.h
+
+RESOURCES += zygote.qrc
@@ -0,0 +1,72 @@
+#include "dk_manager_core.h"
+#include "dkmanager.h"
+#include <QDebug>
+
+DkManagerCore::DkManagerCore(QObject *parent) : QObject(parent)
+{
+    m_thread.setObjectName("dk_manager");
+
+    // DkManger and its timer are created on the dk_manager thread, so they never touch the host's event loop
+    connect(&m_thread, &QThread::started, &m_thread, [this]() {
+        m_manager = new DkManger();
+        m_manager->SetEmbeddedMode(m_embedded);
+        m_manager->SetMockMode(m_mock);
+        connect(m_manager, &DkManger::connectionChanged, this, [this](bool connected) {
+            m_connected = connected;
+            Q_EMIT connectionChanged(connected);
+        });
+        connect(m_manager, &DkManger::messageToKitHandled, this, &DkManagerCore::messageToKitHandled);
+        m_manager->Start();
+        Q_EMIT started();
+    }, Qt::DirectConnection);
+
+    // emitted on the dk_manager thread after its event loop returned: DkManger and its socket.io client are
+    // destroyed on the thread they belong to, the destructor waits for the messageToKit handler threads
+    connect(&m_thread, &QThread::finished, &m_thread, [this]() {
+        delete m_manager;
+        m_manager = nullptr;
+    }, Qt::DirectConnection);
+}
+
+DkManagerCore::~DkManagerCore()
+{
+    Stop();
+}
+
+bool DkManagerCore::Start(bool embedded, bool mock)
+{
+    if (m_thread.isRunning())
+    {
+        qDebug() << __func__ << __LINE__ << " : dk_manager is already running";
+        return false;
+    }
+
+    m_embedded = embedded;
+    m_mock = mock;
+    m_thread.start();
+    return true;
+}
+
+void DkManagerCore::Stop()
+{
+    if (!m_thread.isRunning())
+    {
+        return;
+    }
+    // DkManger is deleted on its own thread when the loop ends, see the finished connection
+    m_thread.quit();
+    m_thread.wait();
+
+    m_connected = false;
+    Q_EMIT stopped();
+}
+
+bool DkManagerCore::IsRunning() const
+{
+    return m_thread.isRunning();
+}
+
+bool DkManagerCore::IsConnected() const
+{
+    return m_connected;
+}
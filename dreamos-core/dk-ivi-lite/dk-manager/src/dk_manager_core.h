@@ -0,0 +1,49 @@
+#ifndef DK_MANAGER_CORE_H
+#define DK_MANAGER_CORE_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <atomic>
+
+#if defined(DK_MANAGER_CORE_LIBRARY)
+#define DK_MANAGER_CORE_EXPORT Q_DECL_EXPORT
+#else
+#define DK_MANAGER_CORE_EXPORT Q_DECL_IMPORT
+#endif
+
+class DkManger;
+
+// Public API of libdk_manager_core, for hosting dk_manager inside another Qt process (dk_ivi).
+// dk_manager runs on a thread of its own; everything else in the library is built with hidden
+// visibility so its globals never bind to symbols of the host.
+class DK_MANAGER_CORE_EXPORT DkManagerCore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DkManagerCore(QObject *parent = nullptr);
+    ~DkManagerCore();
+
+    // Needs a Q(Core/Gui)Application. Returns false if dk_manager is already running.
+    bool Start(bool embedded = true, bool mock = true);
+    void Stop();
+    bool IsRunning() const;
+    bool IsConnected() const;
+
+Q_SIGNALS:
+    void started();
+    void stopped();
+    void connectionChanged(bool connected);
+    // a messageToKit command finished, e.g. "deploy_request" or "action_on_prototype"
+    void messageToKitHandled(const QString &cmd);
+
+private:
+    QThread m_thread;
+    DkManger *m_manager = nullptr;
+    bool m_embedded = true;
+    bool m_mock = true;
+    std::atomic<bool> m_connected{false};
+};
+
+#endif // DK_MANAGER_CORE_H
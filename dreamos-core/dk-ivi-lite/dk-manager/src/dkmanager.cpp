@@ -1,6 +1,10 @@
 #include "dkmanager.h"
 #include "fileutils.h"
 #include "common_utils.h"
+#include "admission_control.h"
+#include "databroker_supervisor.h"
+#include "container_pool.h"
+#include "zygote_runner.h"
 #include <QFile>
 #include <QDebug>
 #include <QThread>
@@ -14,6 +18,9 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QRandomGenerator>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThreadPool>
 
 QMutex digitalAutoPrototypeMutex;
 QMutex vssMappingMutex;
@@ -31,7 +38,21 @@ dk_manager features:
 
 #if 1
 // docker mount option: -v ~/.dk:/app/.dk
-std::string DK_ROOT_DIR = "/app/.dk/";
+// DK_ROOT_DIR in the environment moves the whole tree, e.g. for bench/dk_manager_bench
+static std::string RootDirFromEnv()
+{
+    QByteArray dir = qgetenv("DK_ROOT_DIR");
+    if (dir.isEmpty())
+    {
+        return "/app/.dk/";
+    }
+    if (!dir.endsWith('/'))
+    {
+        dir += '/';
+    }
+    return dir.toStdString();
+}
+std::string DK_ROOT_DIR = RootDirFromEnv();
 
 std::string DK_SWUPDATE_DIR = DK_ROOT_DIR + "dk_swupdate/";
 std::string DK_SWUPDATE_PATCH_DIR = DK_SWUPDATE_DIR + "dk_patch/";
@@ -75,6 +96,10 @@ std::string DK_DOWNLOAD_LOGFILE = (DK_LOG_FOLDER + "requestdownload.log");
 std::string DK_PROTOTYPES_FOLDER = (DK_MGR_ROOT_DIR + "prototypes/");
 std::string DK_PROTOTYPES_LIST = (DK_PROTOTYPES_FOLDER + "prototypes.json");
 std::string DK_SUPPORTED_VSS_FILE = (DK_PROTOTYPES_FOLDER + "supportedvssapi.json");
+std::string DK_BLOB_STORE_FOLDER = (DK_MGR_ROOT_DIR + "blobs/");
+std::string DK_ZYGOTE_FOLDER = (DK_MGR_ROOT_DIR + "zygote/");
+std::string DK_DEPLAYERS_FOLDER = (DK_MGR_ROOT_DIR + "deplayers/");
+std::string DK_POOL_FOLDER = (DK_MGR_ROOT_DIR + "pool/");
 std::string DK_BOARD_UNIQUE_SERIAL_NUMBER_FILE = "/proc/device-tree/serial-number";
 std::string DK_DREAMKIT_UNIQUE_SERIAL_NUMBER_FILE = DK_MGR_ROOT_DIR + "serial-number";
 std::string DK_ECU_LIST = DK_ROOT_DIR + "EcuList.json";
@@ -99,10 +124,13 @@ std::string DK_ZC_USERNAME = "sdv-orin";
 DkManger::DkManger() : _io(new client())
 {
     qDebug() << __func__ << __LINE__ << " : setup socket.io";
+    m_startupTimer.start();
 
     InitDigitalautoFolder();
+    qint64 foldersMs = m_startupTimer.elapsed();
 
     InitUserInfo();
+    qint64 userInfoMs = m_startupTimer.elapsed();
 
     using std::placeholders::_1;
     using std::placeholders::_2;
@@ -128,12 +156,15 @@ DkManger::DkManger() : _io(new client())
     m_timer = new QTimer(this);
     connect(m_timer, SIGNAL(timeout()), this, SLOT(BroadCastGlobalStatus()));
     m_timer->start(2000);
+    qDebug() << __func__ << __LINE__ << " : startup folders " << foldersMs << " ms, user info "
+             << (userInfoMs - foldersMs) << " ms, socket setup " << (m_startupTimer.elapsed() - userInfoMs) << " ms";
 }
 
 void DkManger::OnReconnectingListener()
 {
     qDebug() << __func__ << __LINE__;
     isSocketConnected = false;
+    Q_EMIT connectionChanged(false);
 }
 
 void DkManger::OnSocketCloseListener(std::string const &nsp)
@@ -163,90 +194,145 @@ void DkManger::InitUserInfo()
     qDebug() << __func__ << __LINE__ << " : DK_VCU_USERNAME = " << QString::fromStdString(DK_VCU_USERNAME);
 }
 
-void DkManger::InitDigitalautoFolder()
+// Folders and files written both by dk_manager and by the tools it runs as DK_VCU_USERNAME
+static const QFileDevice::Permissions kOpenPermissions =
+    QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner |
+    QFileDevice::ReadGroup | QFileDevice::WriteGroup | QFileDevice::ExeGroup |
+    QFileDevice::ReadOther | QFileDevice::WriteOther | QFileDevice::ExeOther;
+
+static void EnsureFolder(const std::string &path)
 {
-    qDebug() << __func__ << __LINE__;
-    // Try to Create Log foler
+    if (!QDir().mkpath(QString::fromStdString(path)))
     {
-        std::string cmd;
-        cmd.clear();
+        qDebug() << __func__ << __LINE__ << " : cannot create " << QString::fromStdString(path);
+    }
+}
 
-        cmd = "mkdir -p " + DK_LOG_CMD_FOLDER + " " + DK_PROTOTYPES_FOLDER + " " + DK_DOWNLOAD_FOLDER + " " + DK_VSSMAPPING_FOLDER + " " + DK_ZONECTL_FOLDER + " " + DK_MARKETPLACE_DIR + " " + DK_INSTALLEDSERVICES_DIR + " " + DK_INSTALLEDAPPS_DIR + ";";
-        cmd += "rm " + DK_LOG_CMD_FOLDER + "*;";
-        cmd += "touch " + DK_STOPKUKFEEDER_SCRIPT + ";";
-        cmd += "touch " + DK_STARTKUKFEEDER_SCRIPT + ";";
-        
-        if (!FileUtils::fileExists(DK_INSTALLEDSERVICES_MGRFILE))
-        {
-            cmd += "echo \"[]\" > " + DK_INSTALLEDSERVICES_MGRFILE + ";";
-        }
-        if (!FileUtils::fileExists(DK_INSTALLEDAPSS_MGRFILE))
-        {
-            cmd += "echo \"[]\" > " + DK_INSTALLEDAPSS_MGRFILE + ";";
-        }
+// Create the file with its default content, an existing file is left as it is.
+static void EnsureFile(const std::string &path, const QByteArray &content, bool open = false)
+{
+    QString filePath = QString::fromStdString(path);
+    if (QFileInfo::exists(filePath))
+    {
+        return;
+    }
+    if (FileUtils::WriteFileAtomic(filePath, content) != 0)
+    {
+        return;
+    }
+    if (open)
+    {
+        QFile::setPermissions(filePath, kOpenPermissions);
+    }
+}
 
-        if (!FileUtils::fileExists(DK_VSSOVERLAY_VSPECS))
-        {
-            cmd += "echo 'Vehicle:\n  type: branch\n\n' > " + DK_VSSOVERLAY_VSPECS + ";";
-            // cmd += "touch " + DK_VSSOVERLAY_VSPECS + ";";
-        }
-        if (!FileUtils::fileExists(DK_SUPPORTED_VSS_FILE))
-        {
-            cmd += "echo \"[]\" > " + DK_SUPPORTED_VSS_FILE + ";";
-        }
-        if (!FileUtils::fileExists(DK_VSSMAPPING_DBC_CAN))
-        {
-            cmd += "echo \"[]\" > " + DK_VSSMAPPING_DBC_CAN + ";";
-        }
-        if (!FileUtils::fileExists(DK_DBCDEFAULT_VALUES))
-        {
-            cmd += "echo \"{}\" > " + DK_DBCDEFAULT_VALUES + ";";
-        }
-        if (!FileUtils::fileExists(DK_PROTOTYPES_LIST))
-        {
-            cmd += "touch " + DK_PROTOTYPES_LIST + ";";
-            cmd += "chmod 777 " + DK_PROTOTYPES_LIST + ";";
-            cmd += "chmod 777 -R " + DK_PROTOTYPES_FOLDER + ";";
-        }
-        cmd += "chmod 777 -R " + DK_VSSMAPPING_FOLDER + ";";
-        qDebug() << __func__ << __LINE__ << " cmd = " << QString::fromStdString(cmd);
-        system(cmd.data());
-        QThread::msleep(100);
-
-        if (!FileUtils::fileExists(DK_SYSTEM_CONFIG_FILE)) {
-            cmd.clear();
-            cmd = "echo \"{\\n"
-            "    \\\"xip\\\": {\\n"
-            "        \\\"ip\\\": \\\"192.168.56.48\\\"\\n"
-            "    },\\n"
-            "    \\\"vip\\\": {\\n"
-            "        \\\"ip\\\": \\\"192.168.56.49\\\",\\n"
-            "        \\\"user\\\": \\\"root\\\",\\n"
-            "        \\\"pwd\\\": \\\"\\\"\\n"
-            "    }\\n"
-            "}\" > ";
-            cmd += DK_SYSTEM_CONFIG_FILE;
-            system(cmd.data());
-        }
+void DkManger::InitDigitalautoFolder()
+{
+    // plain filesystem calls, no shell: this runs before anything else on every boot
+    const std::string folders[] = {
+        DK_LOG_CMD_FOLDER, DK_PROTOTYPES_FOLDER, DK_DOWNLOAD_FOLDER, DK_VSSMAPPING_FOLDER,
+        DK_ZONECTL_FOLDER, DK_MARKETPLACE_DIR, DK_INSTALLEDSERVICES_DIR, DK_INSTALLEDAPPS_DIR,
+        DK_BLOB_STORE_FOLDER, DK_ZYGOTE_FOLDER, DK_DEPLAYERS_FOLDER
+    };
+    for (const std::string &folder : folders)
+    {
+        EnsureFolder(folder);
     }
+
+    // cmd logs are per run
+    QDir cmdLogDir(QString::fromStdString(DK_LOG_CMD_FOLDER));
+    for (const QString &name : cmdLogDir.entryList(QDir::Files | QDir::Hidden | QDir::System))
+    {
+        cmdLogDir.remove(name);
+    }
+
+    EnsureFile(DK_STOPKUKFEEDER_SCRIPT, QByteArray(), true);
+    EnsureFile(DK_STARTKUKFEEDER_SCRIPT, QByteArray(), true);
+    EnsureFile(DK_INSTALLEDSERVICES_MGRFILE, "[]\n");
+    EnsureFile(DK_INSTALLEDAPSS_MGRFILE, "[]\n");
+    EnsureFile(DK_VSSOVERLAY_VSPECS, "Vehicle:\n  type: branch\n\n\n", true);
+    EnsureFile(DK_SUPPORTED_VSS_FILE, "[]\n", true);
+    EnsureFile(DK_VSSMAPPING_DBC_CAN, "[]\n", true);
+    EnsureFile(DK_DBCDEFAULT_VALUES, "{}\n", true);
+    EnsureFile(DK_PROTOTYPES_LIST, QByteArray(), true);
+    EnsureFile(DK_SYSTEM_CONFIG_FILE,
+               "{\n"
+               "    \"xip\": {\n"
+               "        \"ip\": \"192.168.56.48\"\n"
+               "    },\n"
+               "    \"vip\": {\n"
+               "        \"ip\": \"192.168.56.49\",\n"
+               "        \"user\": \"root\",\n"
+               "        \"pwd\": \"\"\n"
+               "    }\n"
+               "}\n");
+
+    // only the top level folders, deploys open up their own prototype folder
+    // and the vss tools bring their trees with the right owner
+    QFile::setPermissions(QString::fromStdString(DK_PROTOTYPES_FOLDER), kOpenPermissions);
+    QFile::setPermissions(QString::fromStdString(DK_VSSMAPPING_FOLDER), kOpenPermissions);
 }
 
 void DkManger::Start()
 {
-    qDebug() << "URL: " << kURL;
-    _io->connect(kURL);
+    // DK_SERVER_URL points dk_manager to another server, e.g. the stand-in of bench/dk_manager_bench
+    QByteArray serverUrl = qgetenv("DK_SERVER_URL");
+    if (serverUrl.isEmpty())
+    {
+        serverUrl = kURL;
+    }
+    qDebug() << "URL: " << serverUrl;
+    qint64 connectAt = m_startupTimer.elapsed();
+    _io->connect(serverUrl.toStdString());
+    qint64 readyAt = m_startupTimer.elapsed();
     if (m_orchestrator)
     {
         m_orchestrator->Start();
     }
+    DatabrokerSupervisor::instance()->Init(m_orchestrator);
+    // both shell out to docker, warm them up without holding the event loop
+    QThreadPool::globalInstance()->start([]() {
+        ContainerPool::instance()->Init();
+    });
+    if (ZygoteRunner::Enabled())
+    {
+        QThreadPool::globalInstance()->start([]() {
+            ZygoteRunner::instance()->Init();
+        });
+    }
+    qDebug() << __func__ << __LINE__ << " : startup connect " << (readyAt - connectAt) << " ms, ready after "
+             << readyAt << " ms, services init " << (m_startupTimer.elapsed() - readyAt) << " ms";
 }
 
 DkManger::~DkManger()
 {
     _io->socket()->off_all();
     _io->socket()->off_error();
+
+    // no new handler after off_all() except one that was being created right then, hence the loop
+    while (true)
+    {
+        QSet<MessageToKitHandler *> handlers;
+        {
+            QMutexLocker locker(&m_handlersMutex);
+            handlers.swap(m_handlers);
+        }
+        if (handlers.isEmpty())
+        {
+            break;
+        }
+        for (MessageToKitHandler *handler : handlers)
+        {
+            qDebug() << __func__ << __LINE__ << " : waiting for messageToKitHandler " << handler;
+            handler->wait();
+            delete handler;
+        }
+    }
+
     delete m_timer;
     delete _io;
+    // the supervisor outlives us, don't leave it a dangling orchestrator
+    DatabrokerSupervisor::instance()->SetOrchestrator(nullptr);
     delete m_orchestrator;
 }
 
@@ -254,8 +340,41 @@ void DkManger::OnMessageToKit(std::string const &name, message::ptr const &data,
 {
     // qDebug() << __func__ << __LINE__;
 
+    if ((data->get_flag() == message::flag_object) && data->get_map()["cmd"] &&
+        (data->get_map()["cmd"]->get_flag() == message::flag_string))
+    {
+        std::string cmd = data->get_map()["cmd"]->get_string();
+        int queuePosition = 0;
+        AdmissionControl::Decision decision = AdmissionControl::Admit(cmd, data, queuePosition);
+        if (decision != AdmissionControl::Admitted)
+        {
+            // tell the client right away instead of letting the request hang behind a running pipeline
+            message::ptr Obj = object_message::create();
+            message::ptr requestFrom = data->get_map()["request_from"];
+            Obj->get_map()["request_from"] = string_message::create(requestFrom ? requestFrom->get_string() : "");
+            Obj->get_map()["cmd"] = string_message::create(cmd);
+            Obj->get_map()["result"] = string_message::create("busy");
+            Obj->get_map()["queue_position"] = int_message::create(queuePosition);
+            if (decision == AdmissionControl::Queued)
+            {
+                Obj->get_map()["log"] = string_message::create("Kit is busy, the request is queued at position " + std::to_string(queuePosition) + ".");
+            }
+            else
+            {
+                Obj->get_map()["log"] = string_message::create("Kit is busy and the queue is full, please retry later.");
+            }
+            _io->socket()->emit("messageToKit-kitReply", Obj);
+            return;
+        }
+    }
+
     MessageToKitHandler *messageToKitHandler = new MessageToKitHandler(_io, data, m_orchestrator);
     connect(messageToKitHandler, &MessageToKitHandler::messageToKitHandlerFinished, this, &DkManger::FinishedHandler);
+    connect(messageToKitHandler, &MessageToKitHandler::messageToKitHandled, this, &DkManger::messageToKitHandled);
+    {
+        QMutexLocker locker(&m_handlersMutex);
+        m_handlers.insert(messageToKitHandler);
+    }
     messageToKitHandler->start();
     // qDebug() << __func__ << __LINE__ << "messageToKitHandler address = " << messageToKitHandler;
 }
@@ -295,22 +414,25 @@ void DkManger::OnConnected(std::string const &nsp)
 {
     // qDebug() << __func__ << " - " << QString::fromStdString(nsp);
 
-    QString supportAPIs = FileUtils::ReadFile(QString::fromStdString(DK_SUPPORTED_VSS_FILE));
+    std::string supportAPIs = FileUtils::ReadFileBytes(QString::fromStdString(DK_SUPPORTED_VSS_FILE));
     QString serialNo = CommonUtils::get_dreamkit_code(DK_BOARD_UNIQUE_SERIAL_NUMBER_FILE, DK_DREAMKIT_UNIQUE_SERIAL_NUMBER_FILE);
 
     // register the dreamkit ID to server
     message::ptr obj = object_message::create();
     obj->get_map()["kit_id"] = string_message::create(serialNo.toStdString());
     obj->get_map()["name"] = string_message::create(serialNo.toStdString());
-    obj->get_map()["support_apis"] = string_message::create(supportAPIs.toStdString());
+    obj->get_map()["support_apis"] = string_message::create(std::move(supportAPIs));
     _io->socket()->emit("register_kit", obj);
 
     isSocketConnected = true;
+    Q_EMIT connectionChanged(true);
 }
 
 void DkManger::OnClosed(client::close_reason const &reason)
 {
     qDebug() << __func__ << __LINE__;
+    isSocketConnected = false;
+    Q_EMIT connectionChanged(false);
 }
 
 void DkManger::OnFailed()
@@ -365,7 +487,11 @@ void DkManger::FinishedHandler(MessageToKitHandler *thread)
             //            qDebug() << __func__ << __LINE__ << " - messageToKitHandler->isFinished = " << thread->isFinished();
             if (thread->isFinished())
             {
-                delete thread;
+                QMutexLocker locker(&m_handlersMutex);
+                if (m_handlers.remove(thread))
+                {
+                    delete thread;
+                }
                 return;
             }
         }
@@ -4,6 +4,9 @@
 #include <QObject>
 #include <QThread>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
 #include <sio_client.h>
 #include "vcuorchestrator.hpp"
 #include "message_to_kit_handler.h"
@@ -25,6 +28,9 @@ public Q_SLOTS:
 
 protected:
 Q_SIGNALS:
+    // for an in-process host (DkManagerCore), emitted from the socket.io and handler threads
+    void connectionChanged(bool connected);
+    void messageToKitHandled(const QString &cmd);
 
 private Q_SLOTS:
     void FinishedHandler(MessageToKitHandler *thread);
@@ -53,6 +59,12 @@ private:
     DkOrchestrator *m_orchestrator = nullptr;
 
     QTimer *m_timer;
+    // handler threads that haven't been deleted yet, created on the socket.io thread;
+    // the destructor waits for them, they use _io and m_orchestrator
+    QMutex m_handlersMutex;
+    QSet<MessageToKitHandler *> m_handlers;
+    // since construction, for the startup phase log
+    QElapsedTimer m_startupTimer;
     bool isSocketConnected = false;
     bool isInternetConnected = false;
     bool m_embeddedMode = false;
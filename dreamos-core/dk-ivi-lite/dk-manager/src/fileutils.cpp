@@ -4,6 +4,8 @@
 #include <QDir>
 #include <QDebug>
 #include <QThread>
+#include <QSaveFile>
+#include <cstdint>
 
 FileUtils::FileUtils()
 {
@@ -46,6 +48,109 @@ QString FileUtils::ReadFile(QString filePath)
     return result;
 }
 
+std::string FileUtils::ReadFileBytes(QString filePath)
+{
+    std::string result;
+    if (filePath.length() == 0)
+    {
+        return result;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        qDebug() << filePath << " is not existing";
+        return result;
+    }
+
+    qint64 size = file.size();
+    if (size > 0)
+    {
+        result.resize(size);
+        qint64 n = file.read(&result[0], size);
+        result.resize((n > 0) ? n : 0);
+    }
+    // files without a size up front (e.g. /proc) or that grew meanwhile
+    char buffer[4096];
+    qint64 n;
+    while ((n = file.read(buffer, sizeof(buffer))) > 0)
+    {
+        result.append(buffer, n);
+    }
+    return result;
+}
+
+bool FileUtils::IsValidUtf8(const std::string &bytes)
+{
+    size_t i = 0;
+    const size_t size = bytes.size();
+    while (i < size)
+    {
+        unsigned char c = bytes[i];
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+        // lead byte: length of the sequence and the smallest code point it may encode (no overlongs)
+        size_t len;
+        uint32_t cp;
+        uint32_t min;
+        if ((c & 0xE0) == 0xC0)
+        {
+            len = 2;
+            cp = c & 0x1F;
+            min = 0x80;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            len = 3;
+            cp = c & 0x0F;
+            min = 0x800;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            len = 4;
+            cp = c & 0x07;
+            min = 0x10000;
+        }
+        else
+        {
+            return false;
+        }
+        if (i + len > size)
+        {
+            return false;
+        }
+        for (size_t k = 1; k < len; k++)
+        {
+            unsigned char cc = bytes[i + k];
+            if ((cc & 0xC0) != 0x80)
+            {
+                return false;
+            }
+            cp = (cp << 6) | (cc & 0x3F);
+        }
+        if ((cp < min) || (cp > 0x10FFFF) || ((cp >= 0xD800) && (cp <= 0xDFFF)))
+        {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+std::string FileUtils::ReadTextFile(QString filePath)
+{
+    std::string result = ReadFileBytes(filePath);
+    if (!IsValidUtf8(result))
+    {
+        // e.g. a log cut in the middle of a character, or binary output of the app
+        result = QString::fromUtf8(result.data(), qsizetype(result.size())).toStdString();
+    }
+    return result;
+}
+
 int FileUtils::WriteFile(QString filePath, QString content)
 {
     QFile file(filePath);
@@ -63,6 +168,51 @@ int FileUtils::WriteFile(QString filePath, QString content)
     return 0;
 }
 
+int FileUtils::WriteFileBytes(QString filePath, const char *data, qint64 size)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered))
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -1;
+    }
+    if (file.write(data, size) != size)
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -1;
+    }
+    file.close();
+    return 0;
+}
+
+int FileUtils::WriteFileAtomic(QString filePath, const QByteArray &content)
+{
+    // the rename replaces the inode, carry the permissions of the old file over (main.py is chmod 777'ed on deploy)
+    QFileDevice::Permissions permissions;
+    bool replacing = QFile::exists(filePath);
+    if (replacing)
+    {
+        permissions = QFile::permissions(filePath);
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -1;
+    }
+    if ((file.write(content) != content.size()) || !file.commit())
+    {
+        qDebug() << __func__ << __LINE__ << file.errorString();
+        return -1;
+    }
+    if (replacing && !QFile::setPermissions(filePath, permissions))
+    {
+        qDebug() << __func__ << __LINE__ << " : could not restore the permissions of " << filePath;
+    }
+    return 0;
+}
+
 bool FileUtils::fileExists(std::string path)
 {
     QFileInfo check_file(QString::fromStdString(path));
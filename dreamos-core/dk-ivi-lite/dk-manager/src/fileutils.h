@@ -9,7 +9,18 @@ class FileUtils : public QObject
 public:
     FileUtils();
     static QString ReadFile(QString filePath);
+    // Bytes of the file as they are on disk, for replies that go out as std::string anyway.
+    // Read straight into the returned string, which is the only copy.
+    static std::string ReadFileBytes(QString filePath);
+    // ReadFileBytes for replies that must be text: invalid UTF-8 is replaced with U+FFFD.
+    static std::string ReadTextFile(QString filePath);
+    static bool IsValidUtf8(const std::string &bytes);
     static int WriteFile(QString filePath, QString content);
+    // Write bytes as they are, straight from the caller's buffer (no text conversion, no copy).
+    static int WriteFileBytes(QString filePath, const char *data, qint64 size);
+    // Write to a temp file and rename it over filePath, readers never see a partial file.
+    // An existing file keeps its permissions.
+    static int WriteFileAtomic(QString filePath, const QByteArray &content);
     static int CreateDirIfNotExist(QString filePath);
     static bool fileExists(std::string path);
 };
@@ -1,6 +1,11 @@
 #include "message_to_kit_handler.h"
 #include "fileutils.h"
 #include "common_utils.h"
+#include "response_cache.h"
+#include "admission_control.h"
+#include "databroker_supervisor.h"
+#include "dependency_layers.h"
+#include "zygote_runner.h"
 #include <QFile>
 #include <QDebug>
 #include <QThread>
@@ -38,6 +43,7 @@ extern std::string DK_LOG_CMD_FOLDER;
 extern std::string DK_DATABROKER_LOG;
 extern std::string DK_BOARD_UNIQUE_SERIAL_NUMBER_FILE;
 extern std::string DK_DREAMKIT_UNIQUE_SERIAL_NUMBER_FILE;
+extern std::string DK_BLOB_STORE_FOLDER;
 
 extern QMutex digitalAutoPrototypeMutex;
 extern QMutex vssMappingMutex;
@@ -49,6 +55,7 @@ MessageToKitHandler::MessageToKitHandler(client *_io, message::ptr const &data,
     m_io = _io;
     m_orchestrator = orchestrator;
     m_proto_utils = new Prototype_Utils(QString::fromStdString(DK_PROTOTYPES_FOLDER));
+    m_blob_store = new BlobStore(QString::fromStdString(DK_BLOB_STORE_FOLDER));
 
     QString user_name = qgetenv("USER");
     if (user_name.isEmpty())
@@ -71,6 +78,7 @@ MessageToKitHandler::~MessageToKitHandler()
     qDebug() << __func__ << __LINE__ << " : exit the thread !!!";
     delete m_dapr_utils;
     delete m_proto_utils;
+    delete m_blob_store;
 }
 
 void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
@@ -86,24 +94,39 @@ void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
     std::string execType = obj->get_map()["execType"]->get_string();
     std::string appName = obj->get_map()["appName"]->get_string();
     std::string codeName = obj->get_map()["codeName"]->get_string();
-    std::string codeContent = obj->get_map()["codeContent"]->get_string();
-    int appContentFlag = obj->get_map()["appContent"]->get_flag();
-    std::string appContent = obj->get_map()["appContent"]->get_string();
-    QByteArray binContent = QString::fromStdString(appContent).toLatin1();
+    QByteArray codeContent;
+    QByteArray appContent;
+    QString missingHash;
+    QStringList missingBlobs;
+    if (!m_blob_store->ResolvePayload(obj, "codeContent", codeContent, missingHash) && !missingHash.isEmpty())
+    {
+        missingBlobs.append(missingHash);
+    }
+    missingHash.clear();
+    bool hasAppContent = m_blob_store->ResolvePayload(obj, "appContent", appContent, missingHash);
+    if (!hasAppContent && !missingHash.isEmpty())
+    {
+        missingBlobs.append(missingHash);
+    }
+    QByteArray binContent = QString::fromUtf8(appContent).toLatin1();
     bool is_run_after_deploy = obj->get_map()["run_after_deploy"]->get_bool();
 
     qDebug() << __func__ << __LINE__ << " id : " << QString::fromStdString(id);
     qDebug() << __func__ << __LINE__ << " execType : " << QString::fromStdString(execType);
     qDebug() << __func__ << __LINE__ << " appName : " << QString::fromStdString(appName);
     qDebug() << __func__ << __LINE__ << " codeName : " << QString::fromStdString(codeName);
-    qDebug() << __func__ << __LINE__ << " appContentFlag : " << appContentFlag;
+    qDebug() << __func__ << __LINE__ << " hasAppContent : " << hasAppContent;
     qDebug() << __func__ << __LINE__ << " appContentSize : " << appContent.size();
     qDebug() << __func__ << __LINE__ << " binContentSize : " << binContent.size();
     qDebug() << __func__ << __LINE__ << " is_run_after_deploy : " << is_run_after_deploy;
 
     std::string idFolder = DK_PROTOTYPES_FOLDER + id;
 
-    int n_write_ret = FileUtils::CreateDirIfNotExist(QString::fromStdString(idFolder));
+    int n_write_ret = -1;
+    if (missingBlobs.isEmpty())
+    {
+        n_write_ret = FileUtils::CreateDirIfNotExist(QString::fromStdString(idFolder));
+    }
 
     // write app content to executable file
     if (n_write_ret >= 0)
@@ -121,7 +144,7 @@ void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
     if (n_write_ret >= 0)
     {
         std::string codePath = DK_PROTOTYPES_FOLDER + id + "/" + codeName;
-        n_write_ret = FileUtils::WriteFile(QString::fromStdString(codePath), QString::fromStdString(codeContent));
+        n_write_ret = FileUtils::WriteFileBytes(QString::fromStdString(codePath), codeContent.constData(), codeContent.size());
     }
 
     // Update prototypes.json
@@ -143,6 +166,15 @@ void MessageToKitHandler::AraDeploymentHandler(message::ptr const &data)
     else
     {
         Obj->get_map()["result"] = string_message::create("failed");
+        if (!missingBlobs.isEmpty())
+        {
+            message::ptr missingList = array_message::create();
+            for (const QString &hash : missingBlobs)
+            {
+                missingList->get_vector().push_back(string_message::create(hash.toStdString()));
+            }
+            Obj->get_map()["missing_blobs"] = missingList;
+        }
     }
 
     m_io->socket()->emit("messageToKit-kitReply", Obj);
@@ -157,7 +189,6 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
 {
     digitalAutoPrototypeMutex.lock();
     std::string request_cmd = data->get_map()["cmd"]->get_string();
-    std::string code = data->get_map()["code"]->get_string();
     message::ptr obj = data->get_map()["prototype"];
     std::string name = obj->get_map()["name"]->get_string();
     qDebug() << __func__ << __LINE__ << " name : " << QString::fromStdString(name);
@@ -178,14 +209,9 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
     std::string id = obj->get_map()["id"]->get_string();
     qDebug() << __func__ << __LINE__ << " id : " << QString::fromStdString(id);
 
-    std::string convertedCode = "";
-    int convertedCodeFlag = data->get_map()["convertedCode"]->get_flag();
-    // qDebug() << __func__ << __LINE__ << " convertedCodeFlag = " << convertedCodeFlag;
-    if (sio::message::flag::flag_string == convertedCodeFlag)
-    {
-        convertedCode = data->get_map()["convertedCode"]->get_string();
-    }
-    else
+    QByteArray convertedCode;
+    QString missingHash;
+    if (!m_blob_store->ResolvePayload(data, "convertedCode", convertedCode, missingHash))
     {
         qDebug() << __func__ << __LINE__ << ": Your convertedCode is incorrect. Please check again !!!";
 
@@ -194,6 +220,12 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
         Obj->get_map()["request_from"] = string_message::create(request_from);
         Obj->get_map()["cmd"] = string_message::create(request_cmd);
         Obj->get_map()["result"] = string_message::create("fail");
+        if (!missingHash.isEmpty())
+        {
+            message::ptr missingList = array_message::create();
+            missingList->get_vector().push_back(string_message::create(missingHash.toStdString()));
+            Obj->get_map()["missing_blobs"] = missingList;
+        }
         m_io->socket()->emit("messageToKit-kitReply", Obj);
         digitalAutoPrototypeMutex.unlock();
         return;
@@ -207,7 +239,25 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
     int n_write_ret = FileUtils::CreateDirIfNotExist(QString::fromStdString(idFolder));
     if (n_write_ret >= 0)
     {
-        n_write_ret = FileUtils::WriteFile(QString::fromStdString(mainPyPath), QString::fromStdString(convertedCode));
+        // the generated code goes from the sio message to disk as bytes, without QString/QTextStream round trip
+        n_write_ret = FileUtils::WriteFileBytes(QString::fromStdString(mainPyPath), convertedCode.constData(), convertedCode.size());
+    }
+    message::ptr requirements = data->get_map()["requirements"];
+    if ((n_write_ret >= 0) && requirements && (requirements->get_flag() == message::flag_string))
+    {
+        // extra pip packages of this prototype, the layer is built in the background
+        n_write_ret = FileUtils::WriteFileAtomic(QString::fromStdString(idFolder + "/requirements.txt"),
+                                                 QByteArray::fromStdString(requirements->get_string()));
+        if (n_write_ret >= 0)
+        {
+            // a deploy retries a layer that failed before, the index may have been down
+            DependencyLayerCache::instance()->Prepare(QString::fromStdString(id), true);
+        }
+    }
+    else if (n_write_ret >= 0)
+    {
+        // redeployed without extra packages, the layer of the previous deploy must not be mounted any more
+        QFile::remove(QString::fromStdString(idFolder + "/requirements.txt"));
     }
     if (n_write_ret >= 0)
     {
@@ -228,6 +278,7 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
     if (is_run_after_deploy)
     {
         this->m_dapr_utils->startApp(QString::fromStdString(id));
+        ResponseCache::Invalidate();
     }
 
     std::string request_from = m_data->get_map()["request_from"]->get_string();
@@ -244,45 +295,77 @@ void MessageToKitHandler::DeploymentHandler(message::ptr const &data)
 
 void MessageToKitHandler::HandleListPrototype(message::ptr const &data)
 {
-    QString s_prototypes = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_LIST));
     std::string request_from = data->get_map()["request_from"]->get_string();
     std::string command = data->get_map()["cmd"]->get_string();
-    message::ptr Obj = object_message::create();
 
-    QString rawDaprRunStatus = this->m_dapr_utils->daprCliList();
+    // dashboards poll this from several tabs, share one execution and reuse it until prototypes.json changes.
+    // the dapr status isn't backed by a file, so the result also expires after a short time.
+    Dapr_Utils *dapr_utils = this->m_dapr_utils;
+    ResponseCache::Fields fields = ResponseCache::Fetch(command, QStringList() << QString::fromStdString(DK_PROTOTYPES_LIST), 2000, [dapr_utils]() {
+        ResponseCache::Fields result;
+        result["result"] = FileUtils::ReadFileBytes(QString::fromStdString(DK_PROTOTYPES_LIST));
+        QList<DaprSidecarStatus> sidecars = dapr_utils->daprStatus();
+        result["dapr_status"] = DaprStatusProvider::ToText(sidecars).toStdString();
+        result["dapr_status_json"] = QJsonDocument(DaprStatusProvider::ToJson(sidecars)).toJson(QJsonDocument::Compact).toStdString();
+        return result;
+    });
 
+    message::ptr Obj = object_message::create();
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
-    Obj->get_map()["result"] = string_message::create(s_prototypes.toStdString());
-    Obj->get_map()["dapr_status"] = string_message::create(rawDaprRunStatus.toStdString());
+    for (auto &field : fields)
+    {
+        // fields is our own copy of the cached reply, hand its strings over instead of copying them again
+        Obj->get_map()[field.first] = string_message::create(std::move(field.second));
+    }
+    m_io->socket()->emit("messageToKit-kitReply", Obj);
+}
+
+void MessageToKitHandler::GetDatabrokerStatus(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    QJsonObject metrics = DatabrokerSupervisor::instance()->GetMetrics();
+
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create("get_databroker_status");
+    Obj->get_map()["result"] = string_message::create(QJsonDocument(metrics).toJson(QJsonDocument::Compact).toStdString());
     m_io->socket()->emit("messageToKit-kitReply", Obj);
 }
 
 void MessageToKitHandler::GetSupportAPIs(message::ptr const &data)
 {
-    QString s_prototypes = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_LIST));
     std::string request_from = data->get_map()["request_from"]->get_string();
     std::string command = data->get_map()["cmd"]->get_string();
-    message::ptr Obj = object_message::create();
 
-    QString supportAPIs = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + "supportedvssapi.json"));
+    QString supportAPIsFile = QString::fromStdString(DK_SUPPORTED_VSS_FILE);
+    ResponseCache::Fields fields = ResponseCache::Fetch(command, QStringList() << supportAPIsFile, 0, [supportAPIsFile]() {
+        ResponseCache::Fields result;
+        result["result"] = FileUtils::ReadFileBytes(supportAPIsFile);
+        return result;
+    });
 
+    message::ptr Obj = object_message::create();
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
-    Obj->get_map()["result"] = string_message::create(supportAPIs.toStdString());
+    for (auto &field : fields)
+    {
+        // fields is our own copy of the cached reply, hand its strings over instead of copying them again
+        Obj->get_map()[field.first] = string_message::create(std::move(field.second));
+    }
     m_io->socket()->emit("messageToKit-kitReply", Obj);
 }
 
 void MessageToKitHandler::SetSupportAPIs(message::ptr const &data)
 {
-    QString s_prototypes = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_LIST));
     std::string request_from = data->get_map()["request_from"]->get_string();
     std::string command = data->get_map()["cmd"]->get_string();
     std::string apis = data->get_map()["apis"]->get_string();
     message::ptr Obj = object_message::create();
 
     QString s_result = "fail";
-    int n_write_result = FileUtils::WriteFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + "supportedvssapi.json"), QString::fromStdString(apis));
+    int n_write_result = FileUtils::WriteFile(QString::fromStdString(DK_SUPPORTED_VSS_FILE), QString::fromStdString(apis));
+    ResponseCache::Invalidate();
     if (n_write_result >= 0)
     {
         s_result = "success";
@@ -297,13 +380,93 @@ void MessageToKitHandler::SetSupportAPIs(message::ptr const &data)
     updateSupportedApiList2Server();
 }
 
+void MessageToKitHandler::HandleAnnounceBlobs(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    std::string command = data->get_map()["cmd"]->get_string();
+
+    QStringList hashes;
+    message::ptr hashList = data->get_map()["hashes"];
+    if (hashList && (hashList->get_flag() == message::flag_array))
+    {
+        for (const message::ptr &hash : hashList->get_vector())
+        {
+            if (hash && (hash->get_flag() == message::flag_string))
+            {
+                hashes.append(QString::fromStdString(hash->get_string()).toLower());
+            }
+        }
+    }
+
+    // reply with the hashes the kit doesn't know yet, only those have to be uploaded
+    QStringList missing = m_blob_store->Missing(hashes);
+    qDebug() << __func__ << __LINE__ << " : announced " << hashes.size() << " blobs, missing " << missing.size();
+
+    message::ptr missingList = array_message::create();
+    for (const QString &hash : missing)
+    {
+        missingList->get_vector().push_back(string_message::create(hash.toStdString()));
+    }
+
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create(command);
+    Obj->get_map()["result"] = string_message::create("success");
+    Obj->get_map()["missing"] = missingList;
+    m_io->socket()->emit("messageToKit-kitReply", Obj);
+}
+
+void MessageToKitHandler::HandleUploadBlob(message::ptr const &data)
+{
+    std::string request_from = data->get_map()["request_from"]->get_string();
+    std::string command = data->get_map()["cmd"]->get_string();
+    std::string hash = "";
+    message::ptr hashMsg = data->get_map()["hash"];
+    if (hashMsg && (hashMsg->get_flag() == message::flag_string))
+    {
+        hash = hashMsg->get_string();
+    }
+
+    QString s_result = "fail";
+    message::ptr content = data->get_map()["content"];
+    if (hash.empty())
+    {
+        s_result = "missing hash";
+    }
+    else if (content && (content->get_flag() == message::flag_string))
+    {
+        const std::string &blob = content->get_string();
+        int put_ret = m_blob_store->Put(QString::fromStdString(hash).toLower(), blob.data(), blob.size());
+        if (put_ret >= 0)
+        {
+            s_result = "success";
+        }
+        else if (put_ret == -1)
+        {
+            s_result = "hash mismatch";
+        }
+    }
+
+    message::ptr Obj = object_message::create();
+    Obj->get_map()["request_from"] = string_message::create(request_from);
+    Obj->get_map()["cmd"] = string_message::create(command);
+    Obj->get_map()["hash"] = string_message::create(hash);
+    Obj->get_map()["result"] = string_message::create(s_result.toStdString());
+    m_io->socket()->emit("messageToKit-kitReply", Obj);
+}
+
 void MessageToKitHandler::HandleActionOnPrototype(message::ptr const &data)
 {
-    QString s_result = "";
+    std::string s_result = "";
     std::string request_from = data->get_map()["request_from"]->get_string();
     std::string command = data->get_map()["cmd"]->get_string();
     std::string action = data->get_map()["action"]->get_string();
-    std::string proto_id = data->get_map()["prototype_id"]->get_string();
+    std::string proto_id = "";
+    message::ptr protoIdMsg = data->get_map()["prototype_id"];
+    if (protoIdMsg && (protoIdMsg->get_flag() == message::flag_string))
+    {
+        proto_id = protoIdMsg->get_string();
+    }
     QString s_proto_id = QString::fromStdString(proto_id);
     message::ptr Obj = object_message::create();
 
@@ -315,47 +478,103 @@ void MessageToKitHandler::HandleActionOnPrototype(message::ptr const &data)
     if (action == "start")
     {
         this->m_dapr_utils->startApp(s_proto_id);
+        ResponseCache::Invalidate();
     }
     else if (action == "stop")
     {
         this->m_dapr_utils->stopApp(s_proto_id);
+        ResponseCache::Invalidate();
+    }
+    else if (action == "stop-all")
+    {
+        QList<AppOpResult> results = this->m_dapr_utils->stopApps(this->m_dapr_utils->listPrototypeIds());
+        s_result = QJsonDocument(Dapr_Utils::toJson(results)).toJson(QJsonDocument::Compact).toStdString();
+        ResponseCache::Invalidate();
+    }
+    else if (action == "start-set")
+    {
+        QStringList ids;
+        message::ptr idList = data->get_map()["prototype_ids"];
+        if (idList && (idList->get_flag() == message::flag_array))
+        {
+            for (const message::ptr &id : idList->get_vector())
+            {
+                if (id && (id->get_flag() == message::flag_string))
+                {
+                    ids.append(QString::fromStdString(id->get_string()));
+                }
+            }
+        }
+        QList<AppOpResult> results = this->m_dapr_utils->startApps(ids);
+        s_result = QJsonDocument(Dapr_Utils::toJson(results)).toJson(QJsonDocument::Compact).toStdString();
+        ResponseCache::Invalidate();
     }
     else if (action == "get-log")
     {
-        s_result = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.log"));
+        s_result = FileUtils::ReadTextFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.log"));
     }
     else if (action == "get-app-log")
     {
-        s_result = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/app.log"));
+        s_result = FileUtils::ReadTextFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/app.log"));
     }
     else if (action == "get-python-code")
     {
-        s_result = FileUtils::ReadFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.py"));
+        s_result = FileUtils::ReadTextFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.py"));
     }
     else if (action == "set-python-code")
     {
-        // first try to stop app if it is running
-        cmd += "dapr stop --app-id " + s_proto_id + "  &";
-        system(cmd.toUtf8());
-        QThread::msleep(50);
+        // reload: true skips the stop, the app is then restarted on the new code without recreating
+        // its container (web IDE edit-run loop), see Dapr_Utils::reloadApp()
+        bool reload = false;
+        message::ptr reloadFlag = data->get_map()["reload"];
+        if (reloadFlag && (reloadFlag->get_flag() == message::flag_boolean))
+        {
+            reload = reloadFlag->get_bool();
+        }
+
+        if (!reload)
+        {
+            // first try to stop app if it is running
+            cmd += "dapr stop --app-id " + s_proto_id + "  &";
+            system(cmd.toUtf8());
+            QThread::msleep(50);
+        }
 
-        // then write file
+        // then write file, atomically so that a reloading interpreter never reads half of it
         std::string code = data->get_map()["code"]->get_string();
-        int write_ret = FileUtils::WriteFile(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.py"), QString::fromStdString(code));
-        if (write_ret >= 0)
+        int write_ret = FileUtils::WriteFileAtomic(QString::fromStdString(DK_PROTOTYPES_FOLDER + proto_id + "/main.py"),
+                                                   QByteArray::fromStdString(code));
+        if (write_ret < 0)
         {
-            s_result = "Success";
+            s_result = "Write Error " + std::to_string(write_ret);
+        }
+        else if (reload)
+        {
+            int reload_ret = this->m_dapr_utils->reloadApp(s_proto_id);
+            if (reload_ret == 0)
+            {
+                s_result = "Reloaded";
+            }
+            else if (reload_ret == 1)
+            {
+                // not running, the new code is used on the next start
+                s_result = "Success";
+            }
+            else
+            {
+                s_result = "Reload Error " + std::to_string(reload_ret);
+            }
         }
         else
         {
-            s_result = QString::fromStdString("Write Error " + std::to_string(write_ret));
+            s_result = "Success";
         }
     }
 
     Obj->get_map()["request_from"] = string_message::create(request_from);
     Obj->get_map()["cmd"] = string_message::create(command);
     Obj->get_map()["action"] = string_message::create(action);
-    Obj->get_map()["result"] = string_message::create(s_result.toStdString());
+    Obj->get_map()["result"] = string_message::create(std::move(s_result));
     m_io->socket()->emit("messageToKit-kitReply", Obj);
 }
 
@@ -386,7 +605,21 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
     {
         message::ptr obj = data->get_map()["data"];
         std::string config = obj->get_map()["cmd"]->get_string();
-        std::string payload = obj->get_map()["payload"]->get_string();
+        QByteArray payload;
+        QString missingHash;
+        if (!m_blob_store->ResolvePayload(obj, "payload", payload, missingHash))
+        {
+            if (!missingHash.isEmpty())
+            {
+                vssMappingInfo2Client += "Dbc content is not available on the kit (missing blob " + missingHash + "). Please upload it again.\n";
+            }
+            else
+            {
+                vssMappingInfo2Client += "Dbc content is missing in the request.\n";
+            }
+            vssMappingMutex.unlock();
+            return false;
+        }
         //        qDebug() << __func__ << __LINE__ << " config : " << QString::fromStdString(config);
         //        qDebug() << __func__ << __LINE__ << " payload : " << QString::fromStdString(payload);
 
@@ -517,7 +750,7 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
             }
             file.resize(0);
             QTextStream stream(&file);
-            stream << QString::fromStdString(payload);
+            stream << QString::fromUtf8(payload);
             QThread::msleep(50);
             file.flush();
             file.close();
@@ -1041,6 +1274,9 @@ bool MessageToKitHandler::VssMappingHandler(message::ptr const &data, QString &v
     system("sync");
     QThread::msleep(50);
 
+    // apps were stopped and the supported api list changed
+    ResponseCache::Invalidate();
+
     vssMappingMutex.unlock();
     return true;
 }
@@ -1104,6 +1340,12 @@ bool MessageToKitHandler::GenerateVehicleModel(QString &vssMappingInfo2Client)
         qDebug() << "link new vehicle model ret : " << QString::fromStdString(ret);
     }
 
+    // the zygote has the old model imported, it must not fork another app with it
+    if (ZygoteRunner::Enabled())
+    {
+        ZygoteRunner::instance()->Restart();
+    }
+
     return true;
 }
 
@@ -1145,46 +1387,14 @@ void MessageToKitHandler::StartRunTimeEnv()
 
 void MessageToKitHandler::StartVehicleDatabroker()
 {
-    qDebug() << "start vehicledatabroker on vcu";
-    std::string cmd = "> " + DK_DATABROKER_LOG + ";";
-    // cmd += "sudo -u " + DK_VCU_USERNAME + " dapr run --app-id vehicledatabroker --app-protocol grpc --resources-path /home/" + DK_VCU_USERNAME + "/.dapr/components --config /home/" + DK_VCU_USERNAME + "/.dapr/config.yaml --app-port 6111 -- docker run --rm --init --name vehicledatabroker -e KUKSA_DATA_BROKER_METADATA_FILE=" + DK_VSS_VSPECS_JSON + " -e KUKSA_DATA_BROKER_PORT=6111 -e 50001 -e 3500 -v " + DK_VSS_VSPECS_JSON + ":" + DK_VSS_VSPECS_JSON + " --network host ghcr.io/eclipse/kuksa.val/databroker:0.3.0 > ";
-    cmd += "sudo -u " + DK_VCU_USERNAME + " dapr run --app-id vehicledatabroker --app-protocol grpc --resources-path /home/" + DK_VCU_USERNAME + "/.dapr/components --config /home/" + DK_VCU_USERNAME + "/.dapr/config.yaml --app-port 55555 -- docker run --rm --init --name vehicledatabroker -e KUKSA_DATA_BROKER_METADATA_FILE=" + DK_VSS_VSPECS_JSON + " -e KUKSA_DATA_BROKER_PORT=55555 -e 50001 -e 3500 -v " + DK_VSS_VSPECS_JSON + ":" + DK_VSS_VSPECS_JSON + " --network host ghcr.io/eclipse/kuksa.val/databroker:0.3.0 > ";
-    cmd += DK_DATABROKER_LOG + " 2>&1 &";
-    qDebug() << "vehicledatabroker cmd : " << QString::fromStdString(cmd);
-    system(cmd.c_str());
-    QThread::sleep(3);
+    // returns as soon as the broker answers instead of sleeping a fixed time
+    DatabrokerSupervisor::instance()->StartBroker();
 }
 
 void MessageToKitHandler::StartKuksaFeeder()
 {
-#if 1
-    if (m_orchestrator)
-    {
-        // check vehicledatabroker status before start kuksa feeder
-        std::string cmd = "docker inspect --format '{{json .State.Running}}' vehicledatabroker";
-        std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-        QString databrokerStatus = QString::fromStdString(ret);
-        databrokerStatus.remove(QChar::Null);
-        databrokerStatus.replace("\n", "");
-        qDebug() << "------ vehicledatabroker status : " << databrokerStatus;
-        if (databrokerStatus == "true")
-        {
-            qDebug() << "------ Send cmd to start kuksa-feeder startup script on zonecontroller";
-            m_orchestrator->SendCmd("zonecontroller", "start_kuksa_feeder_script");
-        }
-    }
-#ifdef DREAMKIT_MINI
-    else
-    {
-        qDebug() << __func__ << __LINE__ << ": start_kuksa_feeder_script ret : " << 
-        QString::fromStdString(CommonUtils::runLinuxCommand(DK_STARTKUKFEEDER_SCRIPT.c_str()));
-    }
-#endif
-#else
-    // This is for the testing on VCU.
-    std::string ret = runLinuxCommand(DK_STARTKUKFEEDER_SCRIPT.c_str());
-    std::cout << __func__ << __LINE__ << ": start_kuksa_feeder_script ret : " << ret << "\n";
-#endif
+    // the supervisor holds the feeders back until vehicledatabroker is reachable
+    DatabrokerSupervisor::instance()->StartFeeders();
 }
 
 void MessageToKitHandler::StopRuntimeEnv()
@@ -1197,57 +1407,19 @@ void MessageToKitHandler::StopRuntimeEnv()
 
 void MessageToKitHandler::StopAllDigialAutoApps()
 {
-    // TODO
     qDebug() << "stop all dapr digital.auto apps and the apps based on velocitas";
-    QFile file(QString::fromStdString(DK_PROTOTYPES_LIST));
-    file.open(QIODevice::ReadOnly | QIODevice::Text);
-    if (file.isOpen())
-    {
-        QString data = QString(file.readAll());
-        file.close();
-        //        qDebug() << "raw file: " << data;
-        QJsonArray jsonAppList = QJsonDocument::fromJson(data.toUtf8()).array();
-        for (const auto obj : jsonAppList)
-        {
-            QString appId = obj.toObject().value("id").toString();
-            std::string cmd = "dapr stop " + appId.toStdString();
-            qDebug() << "dapr cmd : " << QString::fromStdString(cmd);
-            std::string ret = CommonUtils::runLinuxCommand(cmd.c_str());
-        }
-    }
+    int failed = this->m_dapr_utils->stopAllApp();
+    qDebug() << __func__ << __LINE__ << " : failed to stop " << failed << " apps";
 }
 
 void MessageToKitHandler::StopVehicleDatabroker()
 {
-    qDebug() << "stop vehicledatabroker on vcu";
-    CommonUtils::runLinuxCommand("docker stop vehicledatabroker");
-    QThread::sleep(2);
-    CommonUtils::runLinuxCommand("dapr stop vehicledatabroker");
-    QThread::sleep(2);
+    DatabrokerSupervisor::instance()->StopBroker();
 }
 
 void MessageToKitHandler::StopKuksaFeeder()
 {
-#if 1
-    if (m_orchestrator)
-    {
-        qDebug() << "Send cmd to stop kuksa-feeder on zonecontroller";
-        // send command to zonecontroller
-        m_orchestrator->SendCmd("zonecontroller", "stop_kuksa_feeder_script");
-    }
-#ifdef DREAMKIT_MINI
-    else {
-        qDebug() << __func__ << __LINE__ << ": stop_kuksa_feeder_script ret : " << 
-        QString::fromStdString(CommonUtils::runLinuxCommand(DK_STOPKUKFEEDER_SCRIPT.c_str()));
-    }
-#endif
-#else
-    // This is for the testing on VCU.
-    {
-        std::string ret = runLinuxCommand(DK_STOPKUKFEEDER_SCRIPT.c_str());
-        std::cout << __func__ << __LINE__ << ": stop_kuksa_feeder_script ret : " << ret << "\n";
-    }
-#endif
+    DatabrokerSupervisor::instance()->StopFeeders();
 }
 
 void MessageToKitHandler::ExecuteCmd(message::ptr const &data)
@@ -1385,6 +1557,7 @@ bool MessageToKitHandler::VssMappingFactoryResetHandler(message::ptr const &data
     }
 
     qDebug() << "Vss Mapping Factory Reset is executed successfully !!!";
+    ResponseCache::Invalidate();
 
     vssMappingFactoryResetMutex.unlock();
     return true;
@@ -1393,23 +1566,38 @@ bool MessageToKitHandler::VssMappingFactoryResetHandler(message::ptr const &data
 void MessageToKitHandler::updateSupportedApiList2Server()
 {
     // notify to all client that apis list is changed
-    QString supportAPIs = FileUtils::ReadFile(QString::fromStdString(DK_SUPPORTED_VSS_FILE));
+    std::string supportAPIs = FileUtils::ReadFileBytes(QString::fromStdString(DK_SUPPORTED_VSS_FILE));
     QString serialNo = CommonUtils::get_dreamkit_code(DK_BOARD_UNIQUE_SERIAL_NUMBER_FILE, DK_DREAMKIT_UNIQUE_SERIAL_NUMBER_FILE);
 
     // register the dreamkit ID to server
     message::ptr obj = object_message::create();
     obj->get_map()["kit_id"] = string_message::create(serialNo.toStdString());
     obj->get_map()["name"] = string_message::create(serialNo.toStdString());
-    obj->get_map()["support_apis"] = string_message::create(supportAPIs.toStdString());
+    obj->get_map()["support_apis"] = string_message::create(std::move(supportAPIs));
     m_io->socket()->emit("register_kit", obj);
 }
 
 void MessageToKitHandler::run()
+{
+    while (m_data)
+    {
+        std::string cmd = Dispatch();
+        Q_EMIT messageToKitHandled(QString::fromStdString(cmd));
+        // a heavy command keeps its admission slot and serves the next parked request of its lane, if any
+        m_data = AdmissionControl::Next(cmd);
+    }
+
+    qDebug() << __func__ << __LINE__ << " MessageToKitHandler::run - end !!!!!!!";
+    Q_EMIT messageToKitHandlerFinished(this);
+}
+
+std::string MessageToKitHandler::Dispatch()
 {
     // qDebug() << __func__ << __LINE__;
+    std::string cmd;
     if (m_data->get_flag() == message::flag_object)
     {
-        std::string cmd = m_data->get_map()["cmd"]->get_string();
+        cmd = m_data->get_map()["cmd"]->get_string();
         qDebug() << __func__ << __LINE__ << " cmd : " << QString::fromStdString(cmd);
 
         if (cmd == "deploy_request")
@@ -1428,10 +1616,22 @@ void MessageToKitHandler::run()
         {
             SetSupportAPIs(m_data);
         }
+        else if (cmd == "announce_blobs")
+        {
+            HandleAnnounceBlobs(m_data);
+        }
+        else if (cmd == "upload_blob")
+        {
+            HandleUploadBlob(m_data);
+        }
         else if (cmd == "list_prototypes")
         {
             HandleListPrototype(m_data);
         }
+        else if (cmd == "get_databroker_status")
+        {
+            GetDatabrokerStatus(m_data);
+        }
         else if (cmd == "action_on_prototype")
         {
             HandleActionOnPrototype(m_data);
@@ -1485,7 +1685,5 @@ void MessageToKitHandler::run()
             qDebug() << __func__ << __LINE__ << ": " << QString::fromStdString(cmd) << " is not supported.";
         }
     }
-
-    qDebug() << __func__ << __LINE__ << " MessageToKitHandler::run - end !!!!!!!";
-    Q_EMIT messageToKitHandlerFinished(this);
+    return cmd;
 }
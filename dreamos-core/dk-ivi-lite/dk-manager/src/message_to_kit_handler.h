@@ -8,6 +8,7 @@
 #include "vcuorchestrator.hpp"
 #include "prototype_utils.h"
 #include "dapr_utils.h"
+#include "blob_store.h"
 
 #define kURL "https://kit.digitalauto.tech"
 
@@ -22,16 +23,19 @@ public:
 
 Q_SIGNALS:
     void messageToKitHandlerFinished(MessageToKitHandler *thread);
+    void messageToKitHandled(const QString &cmd);
 
 private Q_SLOTS:
 
 private:
+    std::string Dispatch();
     void ExecuteCmd(message::ptr const &data);
     void FactoryResetHandler(message::ptr const &data);
     void AraDeploymentHandler(message::ptr const &data);
     void DeploymentHandler(message::ptr const &data);
     void HandleListPrototype(message::ptr const &data);
     void HandleActionOnPrototype(message::ptr const &data);
+    void GetDatabrokerStatus(message::ptr const &data);
     bool VssMappingHandler(message::ptr const &data, QString &vssMappingInfo2Client);
     bool VssMappingFactoryResetHandler(message::ptr const &data, QString &vssMappingInfo2Client);
 
@@ -48,6 +52,8 @@ private:
     bool GenerateVehicleModel(QString &vssMappingInfo2Client);
     void GetSupportAPIs(message::ptr const &data);
     void SetSupportAPIs(message::ptr const &data);
+    void HandleAnnounceBlobs(message::ptr const &data);
+    void HandleUploadBlob(message::ptr const &data);
 
     void updateSupportedApiList2Server();
 
@@ -56,5 +62,6 @@ private:
     DkOrchestrator *m_orchestrator;
     Prototype_Utils *m_proto_utils;
     Dapr_Utils *m_dapr_utils;
+    BlobStore *m_blob_store;
 };
 #endif // MESSAGE_TO_KIT_HANDLER_H
@@ -1,5 +1,6 @@
 #include "prototype_utils.h"
 #include "fileutils.h"
+#include "response_cache.h"
 
 Prototype_Utils::Prototype_Utils(QString root_dir)
 {
@@ -55,6 +56,7 @@ int Prototype_Utils::AppendPrototypeToList(QString proto_id, QString proto_name,
     QJsonDocument newDoc(jsonAppList);
     QString newContent = newDoc.toJson();
     int n_write_result = FileUtils::WriteFile(this->_prototype_dir + "prototypes.json", newContent);
+    ResponseCache::Invalidate();
 
     return n_write_result;
 }
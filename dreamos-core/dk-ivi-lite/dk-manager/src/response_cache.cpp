@@ -0,0 +1,110 @@
+#include "response_cache.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+
+namespace
+{
+struct CacheEntry
+{
+    bool valid = false;
+    bool inFlight = false;
+    quint64 starts = 0;     // producer runs started so far
+    quint64 producedBy = 0; // number of the run that produced fields
+    quint64 generation = 0;
+    QString fingerprint;
+    QElapsedTimer producedAt;
+    ResponseCache::Fields fields;
+};
+
+QMutex cacheMutex;
+QWaitCondition cacheProduced;
+std::map<std::string, CacheEntry> cacheEntries;
+quint64 cacheGeneration = 0;
+}
+
+QString ResponseCache::Fingerprint(const QStringList &files)
+{
+    QString fingerprint;
+    for (const QString &path : files)
+    {
+        QFileInfo info(path);
+        fingerprint += path + ":";
+        if (info.exists())
+        {
+            fingerprint += QString::number(info.size()) + ":" +
+                           QString::number(info.lastModified().toMSecsSinceEpoch()) + ":" +
+                           QString::number(info.fileTime(QFileDevice::FileMetadataChangeTime).toMSecsSinceEpoch());
+        }
+        fingerprint += ";";
+    }
+    return fingerprint;
+}
+
+ResponseCache::Fields ResponseCache::Fetch(const std::string &key, const QStringList &watchedFiles, qint64 maxAgeMs, const Producer &producer)
+{
+    QString fingerprint = Fingerprint(watchedFiles);
+
+    QMutexLocker locker(&cacheMutex);
+    CacheEntry &entry = cacheEntries[key];
+    quint64 seenStarts = entry.starts;
+    for (;;)
+    {
+        bool fresh = entry.valid && (entry.generation == cacheGeneration) && (entry.fingerprint == fingerprint) &&
+                     ((maxAgeMs <= 0) || (entry.producedAt.elapsed() < maxAgeMs));
+        if (fresh)
+        {
+            return entry.fields;
+        }
+        if (!entry.inFlight)
+        {
+            if (entry.valid && (entry.producedBy > seenStarts) && (entry.generation == cacheGeneration))
+            {
+                // produced by a run that started after our request and isn't invalidated, share its result
+                return entry.fields;
+            }
+            break;
+        }
+        cacheProduced.wait(&cacheMutex);
+    }
+
+    entry.inFlight = true;
+    quint64 run = ++entry.starts;
+    quint64 generation = cacheGeneration;
+    locker.unlock();
+
+    Fields fields;
+    try
+    {
+        fields = producer();
+    }
+    catch (...)
+    {
+        locker.relock();
+        entry.inFlight = false;
+        entry.valid = false;
+        cacheProduced.wakeAll();
+        throw;
+    }
+
+    locker.relock();
+    entry.fields = fields;
+    entry.fingerprint = fingerprint;
+    entry.generation = generation;
+    entry.valid = true;
+    entry.inFlight = false;
+    entry.producedBy = run;
+    entry.producedAt.start();
+    cacheProduced.wakeAll();
+    return fields;
+}
+
+void ResponseCache::Invalidate()
+{
+    QMutexLocker locker(&cacheMutex);
+    cacheGeneration++;
+}
@@ -0,0 +1,28 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <QStringList>
+#include <map>
+#include <string>
+#include <functional>
+
+// Shared cache for the replies of read-only messageToKit commands (list_prototypes, get_support_apis).
+// - identical requests that arrive while one is being produced wait for it and get the same result,
+// - a result stays valid until one of its watched files changes (size/mtime/ctime) or Invalidate() is called,
+//   optionally bounded by a max age for the parts that aren't backed by a file (e.g. dapr runtime status).
+class ResponseCache
+{
+public:
+    typedef std::map<std::string, std::string> Fields;
+    typedef std::function<Fields()> Producer;
+
+    static Fields Fetch(const std::string &key, const QStringList &watchedFiles, qint64 maxAgeMs, const Producer &producer);
+
+    // Drop every cached reply. Call it after dk_manager itself changes the registry, the mapping or an app state.
+    static void Invalidate();
+
+private:
+    static QString Fingerprint(const QStringList &files);
+};
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""Pre-forked python runner for dreamKIT prototypes.
+
+The zygote imports the velocitas SDK and the generated vehicle model once, then forks one child per
+prototype. A child starts with every module already loaded, chdirs to the prototype folder, writes its
+output to main.log there and runs main.py as __main__.
+
+dk_manager talks to it over a unix socket, one JSON object per line in both directions:
+    {"cmd": "start", "id": "<prototype id>", "paths": [...]}  -> {"result": "ok", "pid": 123}
+    {"cmd": "stop", "id": "<prototype id>"}   -> {"result": "ok"} | {"result": "not running"}
+    {"cmd": "list"}                           -> {"result": "ok", "running": ["<id>", ...]}
+    {"cmd": "ping"}                           -> {"result": "ok", "preloaded": [...], "preload_ms": 1234}
+
+Startup latency, cold interpreter vs fork from the zygote:
+    python3 dk_zygote.py --bench 10
+"""
+
+import argparse
+import importlib
+import json
+import os
+import signal
+import socket
+import statistics
+import subprocess
+import sys
+import time
+
+DEFAULT_PRELOAD = "asyncio,grpc,sdv,velocitas_sdk,vehicle"
+DEFAULT_PATHS = "/home/python-packages,/home/vss/vehicle_gen"
+
+children = {}  # prototype id -> pid
+
+
+def log(msg):
+    print("[dk_zygote] " + msg, flush=True)
+
+
+def preload(modules, paths):
+    for path in paths:
+        if path and path not in sys.path:
+            sys.path.insert(0, path)
+    # forked children keep working grpc channels only with fork support enabled
+    os.environ.setdefault("GRPC_ENABLE_FORK_SUPPORT", "true")
+    loaded = []
+    start = time.monotonic()
+    for name in modules:
+        try:
+            importlib.import_module(name)
+            loaded.append(name)
+        except Exception as e:  # a missing module must not keep the zygote down
+            log("cannot preload %s: %s" % (name, e))
+    return loaded, int((time.monotonic() - start) * 1000)
+
+
+def reap():
+    while True:
+        try:
+            pid, _ = os.waitpid(-1, os.WNOHANG)
+        except ChildProcessError:
+            return
+        if pid == 0:
+            return
+        for app_id, child in list(children.items()):
+            if child == pid:
+                del children[app_id]
+
+
+def run_child(app_dir, paths, inherited):
+    # the zygote's listening socket and client connection are not the app's business: an app
+    # holding them would keep the client waiting for EOF and the socket path bound after a zygote exit.
+    # detach() first, the objects must not close a reused fd number later
+    for sock in inherited:
+        os.close(sock.detach())
+    # the child owns its process group, stop kills everything main.py spawned
+    os.setsid()
+    signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+    signal.signal(signal.SIGTERM, signal.SIG_DFL)
+    os.chdir(app_dir)
+    fd = os.open("main.log", os.O_WRONLY | os.O_CREAT | os.O_TRUNC, 0o666)
+    os.dup2(fd, 1)
+    os.dup2(fd, 2)
+    os.close(fd)
+    # the prototype's own dependency layer goes in front of the preloaded packages
+    for path in reversed(paths):
+        sys.path.insert(0, path)
+    sys.path.insert(0, app_dir)
+    sys.argv = ["main.py"]
+    code = 0
+    try:
+        import runpy
+        runpy.run_path("main.py", run_name="__main__")
+    except SystemExit as e:
+        code = e.code if isinstance(e.code, int) else 1
+    except BaseException:
+        import traceback
+        traceback.print_exc()
+        code = 1
+    sys.stdout.flush()
+    sys.stderr.flush()
+    os._exit(code)
+
+
+def start(app_id, prototypes_dir, paths, inherited):
+    app_dir = os.path.join(prototypes_dir, app_id)
+    if not app_id or "/" in app_id or not os.path.isfile(os.path.join(app_dir, "main.py")):
+        return {"result": "not deployed"}
+    stop(app_id)
+    pid = os.fork()
+    if pid == 0:
+        run_child(app_dir, paths, inherited)
+    children[app_id] = pid
+    return {"result": "ok", "pid": pid}
+
+
+def stop(app_id, timeout=2.0):
+    pid = children.pop(app_id, None)
+    if pid is None:
+        return {"result": "not running"}
+    try:
+        os.killpg(pid, signal.SIGTERM)
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            if os.waitpid(pid, os.WNOHANG)[0] == pid:
+                return {"result": "ok"}
+            time.sleep(0.05)
+        os.killpg(pid, signal.SIGKILL)
+        os.waitpid(pid, 0)
+    except (ProcessLookupError, ChildProcessError):
+        pass
+    return {"result": "ok"}
+
+
+def handle(request, args, info, inherited):
+    cmd = request.get("cmd")
+    if cmd == "start":
+        return start(str(request.get("id", "")), args.prototypes, [str(p) for p in request.get("paths", [])], inherited)
+    if cmd == "stop":
+        return stop(str(request.get("id", "")))
+    if cmd == "list":
+        reap()
+        return {"result": "ok", "running": sorted(children.keys())}
+    if cmd == "ping":
+        return dict(info, result="ok")
+    return {"result": "unknown cmd"}
+
+
+def serve(args):
+    loaded, preload_ms = preload(args.preload.split(","), args.path.split(","))
+    log("preloaded %s in %d ms" % (",".join(loaded), preload_ms))
+    info = {"preloaded": loaded, "preload_ms": preload_ms}
+
+    if os.path.exists(args.socket):
+        os.unlink(args.socket)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(args.socket)
+    os.chmod(args.socket, 0o666)
+    server.listen(16)
+    signal.signal(signal.SIGCHLD, lambda signum, frame: reap())
+    signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(0))
+    log("listening on " + args.socket)
+
+    try:
+        while True:
+            try:
+                conn, _ = server.accept()
+            except InterruptedError:
+                continue
+            with conn, conn.makefile("rw") as stream:
+                for line in stream:
+                    try:
+                        reply = handle(json.loads(line), args, info, [server, conn])
+                    except (ValueError, AttributeError) as e:
+                        reply = {"result": "bad request: %s" % e}
+                    stream.write(json.dumps(reply) + "\n")
+                    stream.flush()
+    finally:
+        for app_id in list(children.keys()):
+            stop(app_id)
+
+
+def bench(args):
+    """Time until the preloaded modules are importable: fresh interpreter vs fork of a warm one."""
+    modules = [m for m in args.preload.split(",") if m]
+    paths = [p for p in args.path.split(",") if p]
+    env = dict(os.environ, PYTHONPATH=os.pathsep.join(paths + [os.environ.get("PYTHONPATH", "")]))
+    probe = "import importlib\nfor m in %r:\n    try: importlib.import_module(m)\n    except Exception: pass\n" % modules
+
+    cold = []
+    for _ in range(args.bench):
+        start_ts = time.monotonic()
+        subprocess.run([sys.executable, "-c", probe], env=env, check=False)
+        cold.append((time.monotonic() - start_ts) * 1000)
+
+    loaded, preload_ms = preload(modules, paths)
+    warm = []
+    for _ in range(args.bench):
+        start_ts = time.monotonic()
+        pid = os.fork()
+        if pid == 0:
+            exec(probe)
+            os._exit(0)
+        os.waitpid(pid, 0)
+        warm.append((time.monotonic() - start_ts) * 1000)
+
+    def row(name, samples):
+        return "%-8s n=%-3d min=%8.1f ms  p50=%8.1f ms  max=%8.1f ms" % (
+            name, len(samples), min(samples), statistics.median(samples), max(samples))
+
+    print("preload: %s (%d ms in the zygote)" % (",".join(loaded) or "-", preload_ms))
+    print(row("cold", cold))
+    print(row("zygote", warm))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="dreamKIT python zygote")
+    parser.add_argument("--socket", default="/app/zygote/zygote.sock")
+    parser.add_argument("--prototypes", default="/app/prototypes")
+    parser.add_argument("--preload", default=DEFAULT_PRELOAD, help="comma separated modules to import once")
+    parser.add_argument("--path", default=DEFAULT_PATHS, help="comma separated folders added to sys.path")
+    parser.add_argument("--bench", type=int, default=0, metavar="N", help="compare N cold starts with N zygote starts and exit")
+    args = parser.parse_args()
+
+    if args.bench > 0:
+        bench(args)
+    else:
+        serve(args)
+
+
+if __name__ == "__main__":
+    main()
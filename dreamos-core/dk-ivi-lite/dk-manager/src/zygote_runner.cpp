@@ -0,0 +1,181 @@
+#include "zygote_runner.h"
+#include "common_utils.h"
+#include "dependency_layers.h"
+#include <QDebug>
+#include <QFile>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QThread>
+
+extern std::string DK_VCU_USERNAME;
+extern std::string DK_ARCH;
+extern std::string DK_DOCKER_HUB_NAMESPACE;
+extern std::string DK_ZYGOTE_FOLDER;
+
+ZygoteRunner *ZygoteRunner::instance()
+{
+    static ZygoteRunner runner;
+    return &runner;
+}
+
+bool ZygoteRunner::Enabled()
+{
+    return qgetenv("DK_PROTOTYPE_RUNNER") == "zygote";
+}
+
+ZygoteRunner::ZygoteRunner()
+{
+    m_socketPath = QString::fromStdString(DK_ZYGOTE_FOLDER) + "zygote.sock";
+}
+
+void ZygoteRunner::Init()
+{
+    QString scriptPath = QString::fromStdString(DK_ZYGOTE_FOLDER) + "dk_zygote.py";
+    QFile embedded(":/zygote/dk_zygote.py");
+    if (!embedded.open(QIODevice::ReadOnly))
+    {
+        qDebug() << __func__ << __LINE__ << " : dk_zygote.py is not embedded";
+        return;
+    }
+    QByteArray script = embedded.readAll();
+
+    // keep a running zygote (and the apps forked from it) unless dk_manager brings a new script
+    bool changed = true;
+    QFile installed(scriptPath);
+    if (installed.open(QIODevice::ReadOnly))
+    {
+        changed = (installed.readAll() != script);
+        installed.close();
+    }
+    if (changed)
+    {
+        if (!installed.open(QIODevice::WriteOnly | QIODevice::Truncate) || (installed.write(script) != script.size()))
+        {
+            qDebug() << __func__ << __LINE__ << installed.errorString();
+            return;
+        }
+        installed.close();
+    }
+
+    QString running = QString::fromStdString(CommonUtils::runLinuxCommand("docker ps -q --filter name=^dk_zygote$ 2>/dev/null")).trimmed();
+    if (!changed && !running.isEmpty())
+    {
+        qDebug() << __func__ << __LINE__ << " : dk_zygote is up to date";
+        return;
+    }
+
+    QString home = "/home/" + QString::fromStdString(DK_VCU_USERNAME) + "/.dk/";
+    QString cmd = "docker rm -f dk_zygote > /dev/null 2>&1; ";
+    cmd += "docker run -d --name dk_zygote --restart unless-stopped --log-opt max-size=10m --log-opt max-file=3";
+    cmd += " -v " + home + "dk_vssgeneration/vehicle_gen/:/home/vss/vehicle_gen:ro";
+    cmd += " -v " + home + "dk_app_python_template/target/" + QString::fromStdString(DK_ARCH) + "/python-packages:/home/python-packages:ro";
+    cmd += " -v " + home + "dk_manager/prototypes:/app/prototypes";
+    cmd += " -v " + home + "dk_manager/zygote:/app/zygote";
+    cmd += " -v " + home + "dk_manager/deplayers:/home/deplayers:ro";
+    cmd += " --network host --entrypoint python3 " + QString::fromStdString(DK_DOCKER_HUB_NAMESPACE) + "/dk_app_python_template:baseimage";
+    cmd += " /app/zygote/dk_zygote.py --socket /app/zygote/zygote.sock --prototypes /app/prototypes";
+    qDebug() << cmd;
+    system(cmd.toUtf8());
+}
+
+void ZygoteRunner::Restart()
+{
+    QString running = QString::fromStdString(CommonUtils::runLinuxCommand("docker ps -q --filter name=^dk_zygote$ 2>/dev/null")).trimmed();
+    if (running.isEmpty())
+    {
+        // not started (yet), Init() preloads the current model
+        return;
+    }
+
+    // a restart also mounts vehicle_gen again, in case the generator replaced the folder
+    QElapsedTimer timer;
+    timer.start();
+    system("docker restart -t 2 dk_zygote > /dev/null 2>&1");
+
+    // wait for the preload, until then a start falls back to a container
+    QJsonObject reply;
+    while (!Call(QJsonObject{{"cmd", "ping"}}, reply, 1000) && (timer.elapsed() < 30000))
+    {
+        QThread::msleep(200);
+    }
+    qDebug() << __func__ << __LINE__ << " : dk_zygote restarted in " << timer.elapsed() << " ms, preloaded "
+             << reply.value("preloaded").toArray().size() << " modules";
+}
+
+int ZygoteRunner::StartApp(const QString &app_id)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QJsonObject request{{"cmd", "start"}, {"id", app_id}};
+    QString layer = DependencyLayerCache::instance()->ReadyLayerOf(app_id);
+    if (!layer.isEmpty())
+    {
+        request["paths"] = QJsonArray{DependencyLayerCache::ContainerPath(layer)};
+    }
+    QJsonObject reply;
+    if (!Call(request, reply) || (reply.value("result").toString() != "ok"))
+    {
+        qDebug() << __func__ << __LINE__ << " : zygote cannot start " << app_id << " : " << reply.value("result").toString();
+        return -1;
+    }
+    qDebug() << __func__ << __LINE__ << " : " << app_id << " forked as pid " << reply.value("pid").toInt() << " in " << timer.elapsed() << " ms";
+    return 0;
+}
+
+int ZygoteRunner::StopApp(const QString &app_id)
+{
+    QJsonObject reply;
+    if (!Call(QJsonObject{{"cmd", "stop"}, {"id", app_id}}, reply))
+    {
+        return -1;
+    }
+    return (reply.value("result").toString() == "ok") ? 0 : 1;
+}
+
+QSet<QString> ZygoteRunner::RunningApps()
+{
+    QSet<QString> ids;
+    QJsonObject reply;
+    if (Call(QJsonObject{{"cmd", "list"}}, reply))
+    {
+        for (const QJsonValue &id : reply.value("running").toArray())
+        {
+            ids.insert(id.toString());
+        }
+    }
+    return ids;
+}
+
+bool ZygoteRunner::Call(const QJsonObject &request, QJsonObject &reply, int timeoutMs)
+{
+    // one short connection per request, the zygote serves them one after the other
+    QLocalSocket socket;
+    socket.connectToServer(m_socketPath);
+    if (!socket.waitForConnected(timeoutMs))
+    {
+        qDebug() << __func__ << __LINE__ << " : " << m_socketPath << " : " << socket.errorString();
+        return false;
+    }
+
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact) + "\n");
+    if (!socket.waitForBytesWritten(timeoutMs))
+    {
+        return false;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (!socket.canReadLine())
+    {
+        int left = timeoutMs - int(timer.elapsed());
+        if ((left <= 0) || !socket.waitForReadyRead(left))
+        {
+            qDebug() << __func__ << __LINE__ << " : no reply from zygote";
+            return false;
+        }
+    }
+    reply = QJsonDocument::fromJson(socket.readLine()).object();
+    socket.disconnectFromServer();
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef ZYGOTE_RUNNER_H
+#define ZYGOTE_RUNNER_H
+
+#include <QString>
+#include <QSet>
+#include <QJsonObject>
+
+// Runs prototypes as forks of a long-lived python process (zygote/dk_zygote.py) that has the
+// velocitas SDK and the vehicle model imported already, instead of one fresh interpreter per app.
+// The zygote runs in the dk_zygote container and is reached over DK_ZYGOTE_FOLDER/zygote.sock.
+// Opt in with DK_PROTOTYPE_RUNNER=zygote; Dapr_Utils falls back to containers if the zygote fails.
+class ZygoteRunner
+{
+public:
+    static ZygoteRunner *instance();
+    static bool Enabled();
+
+    // Install the embedded dk_zygote.py and (re)start the dk_zygote container if needed.
+    void Init();
+    // Restart a running zygote so that it imports the vehicle model again; call whenever vehicle_gen is
+    // regenerated, a fork would run on the old model otherwise. Apps forked from it stop with it.
+    void Restart();
+    // Returns 0 on success, -1 if the zygote couldn't start the app.
+    int StartApp(const QString &app_id);
+    // Returns 0 when stopped, 1 if the app doesn't run in the zygote, -1 on error.
+    int StopApp(const QString &app_id);
+    QSet<QString> RunningApps();
+
+private:
+    ZygoteRunner();
+    bool Call(const QJsonObject &request, QJsonObject &reply, int timeoutMs = 3000);
+
+    QString m_socketPath;
+};
+
+#endif // ZYGOTE_RUNNER_H
@@ -0,0 +1,151 @@
+// Memory, thread and CPU cost per subscribed signal against a running databroker.
+//
+//   vapi_subscription_bench --mode legacy|hub [--server 127.0.0.1:55555] [--paths file]
+//                           [--consumers 1] [--seconds 10] [--max-rate 0] [--deadband 0]
+//
+// legacy: every consumer starts its own KuksaClient::SubscriptionManager, as VAPIClient::subscribe did.
+// hub:    every consumer goes through VAPIClient::subscribe, which shares one upstream per path.
+// Run both modes with the same arguments and compare the per-signal numbers.
+// With the default single consumer per signal (the IVI pages subscribe each path once) both modes
+// cost the same, one stream and thread per signal: KuksaClient is prebuilt, the per-signal thread is
+// not something VAPIClient can remove. The hub only pays off with --consumers > 1, i.e. when the same
+// path is subscribed several times; threads_per_signal shows which case was measured.
+// --max-rate / --deadband set the hub SubscribeOptions; updates_per_s then counts delivered updates.
+
+#include "../library/vapiclient/vapiclient.hpp"
+#include <sys/resource.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+long statusField(const char *name)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    size_t len = std::strlen(name);
+    while (std::getline(status, line)) {
+        if (line.compare(0, len, name) == 0) {
+            return std::atol(line.c_str() + len);
+        }
+    }
+    return -1;
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+std::vector<std::string> defaultPaths()
+{
+    using namespace VAPI::VehicleAPI;
+    return { V_Bo_Lights_Beam_Low_IsOn, V_Bo_Lights_Beam_High_IsOn, V_Bo_Lights_Hazard_IsSignaling,
+             V_Ca_Seat_R1_DriverSide_Position, V_Ca_HVAC_Station_R1_Driver_FanSpeed,
+             V_Ca_HVAC_Station_R1_Passenger_FanSpeed, V_Ca_Lights_Ambient_Intensity,
+             V_Ca_Lights_Ambient_IsLightOn, V_PT_Trans_SelectedGear };
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::string mode = "hub";
+    std::string server = DK_VAPI_DATABROKER;
+    std::string pathsFile;
+    int consumers = 1;
+    int seconds = 10;
+    SubscribeOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--mode") mode = argv[i + 1];
+        else if (arg == "--server") server = argv[i + 1];
+        else if (arg == "--paths") pathsFile = argv[i + 1];
+        else if (arg == "--consumers") consumers = std::atoi(argv[i + 1]);
+        else if (arg == "--seconds") seconds = std::atoi(argv[i + 1]);
+        else if (arg == "--max-rate") options.maxRateHz = std::atof(argv[i + 1]);
+        else if (arg == "--deadband") options.deadband = std::atof(argv[i + 1]);
+        else {
+            std::cerr << "unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::string> paths;
+    if (!pathsFile.empty()) {
+        std::ifstream in(pathsFile);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!line.empty()) paths.push_back(line);
+        }
+    } else {
+        paths = defaultPaths();
+    }
+
+    VAPI_CLIENT.connectToServer(server);
+    // start the VAPIClient worker and get threads (created on first use) before the baseline,
+    // so threads_added only counts what the subscriptions cost
+    VAPI_CLIENT.getValuesAsync(server, paths, ValueField::Current).wait();
+
+    long rssBefore = statusField("VmRSS:");
+    long threadsBefore = statusField("Threads:");
+
+    std::atomic<long> updates{0};
+    auto count = [&updates](const std::string &, const std::string &) { updates++; };
+
+    KuksaClient::DataBrokerClient legacyClient;
+    std::vector<std::unique_ptr<KuksaClient::SubscriptionManager>> legacy;
+    if (mode == "legacy") {
+        legacyClient.Connect(server);
+        for (int c = 0; c < consumers; ++c) {
+            auto manager = std::make_unique<KuksaClient::SubscriptionManager>(legacyClient, paths);
+            manager->startSubscriptions(count);
+            manager->detachAll();
+            legacy.push_back(std::move(manager));
+        }
+    } else {
+        for (int c = 0; c < consumers; ++c) {
+            VAPI_CLIENT.subscribe(server, paths, count, options);
+        }
+    }
+
+    // let the streams come up before measuring
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    long rssAfter = statusField("VmRSS:");
+    long threadsAfter = statusField("Threads:");
+
+    long updatesStart = updates;
+    double cpuStart = cpuSeconds();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    double cpu = cpuSeconds() - cpuStart;
+    long received = updates - updatesStart;
+
+    size_t subscribed = paths.size() * consumers;
+    std::cout << "{\"mode\":\"" << mode << "\""
+              << ",\"signals\":" << paths.size()
+              << ",\"consumers\":" << consumers
+              << ",\"max_rate_hz\":" << options.maxRateHz
+              << ",\"deadband\":" << options.deadband
+              << ",\"upstreams\":" << (mode == "legacy" ? subscribed : VAPI_CLIENT.upstreamSubscriptionCount())
+              << ",\"threads_added\":" << (threadsAfter - threadsBefore)
+              << ",\"threads_per_signal\":" << double(threadsAfter - threadsBefore) / paths.size()
+              << ",\"rss_kb_added\":" << (rssAfter - rssBefore)
+              << ",\"rss_kb_per_subscription\":" << double(rssAfter - rssBefore) / subscribed
+              << ",\"updates_per_s\":" << double(received) / seconds
+              << ",\"cpu_ms_per_s\":" << cpu * 1000 / seconds
+              << ",\"cpu_us_per_update\":" << (received ? cpu * 1e6 / received : 0)
+              << "}" << std::endl;
+
+    // subscription threads are detached and never return, don't wait for them
+    std::_Exit(0);
+}
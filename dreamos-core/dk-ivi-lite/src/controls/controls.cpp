@@ -12,147 +12,132 @@ ControlsAsync::ControlsAsync()
 {
     qDebug() << __func__ << " - " << __LINE__ << " ===============================";
 
-    std::vector<std::string> signalPaths;
-    signalPaths.push_back(VehicleAPI::V_Bo_Lights_Beam_Low_IsOn);
-    signalPaths.push_back(VehicleAPI::V_Bo_Lights_Beam_High_IsOn);
-    signalPaths.push_back(VehicleAPI::V_Bo_Lights_Hazard_IsSignaling);
-    signalPaths.push_back(VehicleAPI::V_Ca_Seat_R1_DriverSide_Position);
-    signalPaths.push_back(VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed);
-    signalPaths.push_back(VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed);
-    
-    VAPI_CLIENT.subscribeTarget(DK_VAPI_DATABROKER, signalPaths,
-        [this](const std::string &updatePath, const std::string &updateValue) {
-            this->vssSubsribeCallback(updatePath, updateValue);
-        }
-    );
+    bindSignal(VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, [this](const SignalValue &value) {
+        qDebug() << "Updating low beam widget to:" << value.toBool();
+        updateWidget_lightCtr_lowBeam(value.toBool());
+    });
+    bindSignal(VehicleAPI::V_Bo_Lights_Beam_High_IsOn, [this](const SignalValue &value) {
+        updateWidget_lightCtr_highBeam(value.toBool());
+    });
+    bindSignal(VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, [this](const SignalValue &value) {
+        updateWidget_lightCtr_Hazard(value.toBool());
+    });
+    bindSignal(VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, [this](const SignalValue &value) {
+        if (value.isNumber()) updateWidget_seat_driverSide_position(int(value.toInt()));
+    });
+    bindSignal(VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, [this](const SignalValue &value) {
+        if (value.isNumber()) updateWidget_hvac_driverSide_FanSpeed(int(value.toInt() / 10));
+    });
+    bindSignal(VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, [this](const SignalValue &value) {
+        if (value.isNumber()) updateWidget_hvac_passengerSide_FanSpeed(int(value.toInt() / 10));
+    });
+
+    // Updates arrive on the VAPI threads; the queue keeps the latest value per signal and
+    // hands them to vssSubsribeCallback on the GUI thread, at most once per signal per frame.
+    m_updates = new SignalUpdateQueue(m_signalHandles,
+        [this](SignalHandle updateHandle, const SignalValue &updateValue) {
+            this->vssSubsribeCallback(updateHandle, updateValue);
+        }, 16, this);
+
+    // m_updaters is complete before the first update can arrive, it is only read from here on.
+    // The widgets only show states, repeated values are dropped in VAPIClient already.
+    SubscribeOptions options;
+    options.onChangeOnly = true;
+    SignalUpdateQueue *updates = m_updates;
+    for (SignalHandle handle : m_signalHandles) {
+        VAPI_CLIENT.subscribeHandle(handle, [updates](SignalHandle updateHandle, const SignalValue &updateValue) {
+            updates->post(updateHandle, updateValue);
+        }, options);
+    }
 }
 
-void ControlsAsync::init()
+void ControlsAsync::bindSignal(const std::string &path, std::function<void(const SignalValue &)> update)
 {
-    QThread::msleep(300);
+    SignalHandle handle = VAPI_CLIENT.signalHandle(DK_VAPI_DATABROKER, ValueField::Target, path);
+    m_signalPaths.push_back(path);
+    m_signalHandles.push_back(handle);
+    if (m_updaters.size() <= handle) {
+        m_updaters.resize(handle + 1);
+    }
+    m_updaters[handle] = std::move(update);
+}
 
-    bool bool_val = false;
-    std::string val = "";
+void ControlsAsync::init()
+{
+    // one concurrent batch for the whole page, the cost no longer grows with the number of signals;
+    // the widgets are filled in on the GUI thread once it is back
+    VAPI_CLIENT.getValuesAsync(DK_VAPI_DATABROKER, m_signalPaths, ValueField::Target, this,
+        [this](const ValueResults &values) {
+            for (size_t i = 0; i < m_signalPaths.size(); ++i) {
+                auto it = values.find(m_signalPaths[i]);
+                if (it == values.end() || !it->second.ok) {
+                    qDebug() << "Failed to get target value of" << QString::fromStdString(m_signalPaths[i]);
+                    continue;
+                }
+                updateWidget(m_signalHandles[i], it->second.toSignalValue());
+            }
+        });
+}
 
-    // Initialize lighting controls
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, val);
-    if (val == "true") bool_val = true;
-    else bool_val = false;
-    updateWidget_lightCtr_lowBeam(bool_val);
-    
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_High_IsOn, val);
-    if (val == "true") bool_val = true;
-    else bool_val = false;
-    updateWidget_lightCtr_highBeam(bool_val);
-    
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, val);
-    if (val == "true") bool_val = true;
-    else bool_val = false;
-    updateWidget_lightCtr_Hazard(bool_val);
-
-    // Initialize seat position
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, val);
-    try {
-        int position = std::stoi(val);
-        updateWidget_seat_driverSide_position(position);
-    } catch (const std::exception& e) {
-        qDebug() << "Error converting seat position value:" << QString::fromStdString(val);
-    }
+void ControlsAsync::vssSubsribeCallback(SignalHandle updateHandle, const SignalValue &updateValue) 
+{
+    qDebug() << "Subscription callback received - Signal:" << updateHandle
+             << "Value:" << QString::fromStdString(updateValue.toString());
+    updateWidget(updateHandle, updateValue);
+}
 
-    // Initialize HVAC fan speeds
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, val);
-    try {
-        int speed = std::stoi(val)/10;
-        updateWidget_hvac_driverSide_FanSpeed(speed);
-    } catch (const std::exception& e) {
-        qDebug() << "Error converting driver fan speed value:" << QString::fromStdString(val);
-    }
-    
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, val);
-    try {
-        int speed = std::stoi(val)/10;
-        updateWidget_hvac_passengerSide_FanSpeed(speed);
-    } catch (const std::exception& e) {
-        qDebug() << "Error converting passenger fan speed value:" << QString::fromStdString(val);
+void ControlsAsync::updateWidget(SignalHandle handle, const SignalValue &value)
+{
+    if (handle < m_updaters.size() && m_updaters[handle]) {
+        m_updaters[handle](value);
     }
 }
 
-void ControlsAsync::vssSubsribeCallback(const std::string &updatePath, const std::string &updateValue) 
+void ControlsAsync::writeValues(const std::string &path, ValueBatch batch, const SignalValue &expected)
 {
-    qDebug() << "Subscription callback received - Path:" << QString::fromStdString(updatePath) 
-             << "Value:" << QString::fromStdString(updateValue);
-    
-    bool bool_val = false;
-    if (updateValue == "true") bool_val = true;
-    else if (updateValue == "false") bool_val = false;
-    
-    if (updatePath == VehicleAPI::V_Bo_Lights_Beam_Low_IsOn) {
-        qDebug() << "Updating low beam widget to:" << bool_val;
-        updateWidget_lightCtr_lowBeam(bool_val);
-    }
-    else if (updatePath == VehicleAPI::V_Bo_Lights_Beam_High_IsOn) {
-        updateWidget_lightCtr_highBeam(bool_val);
-    }
-    else if (updatePath == VehicleAPI::V_Bo_Lights_Hazard_IsSignaling) {
-        updateWidget_lightCtr_Hazard(bool_val);
-    }
-    else if (updatePath == VehicleAPI::V_Ca_Seat_R1_DriverSide_Position) {
-        try {
-            int position = std::stoi(updateValue);
-            updateWidget_seat_driverSide_position(position);
-        } catch (const std::exception& e) {
-            qDebug() << "Error converting seat position value:" << QString::fromStdString(updateValue);
-        }
-    }
-    else if (updatePath == VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed) {
-        try {
-            int speed = std::stoi(updateValue)/10;
-            updateWidget_hvac_driverSide_FanSpeed(speed);
-        } catch (const std::exception& e) {
-            qDebug() << "Error converting driver fan speed value:" << QString::fromStdString(updateValue);
-        }
-    }
-    else if (updatePath == VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed) {
-        try {
-            int speed = std::stoi(updateValue)/10;
-            updateWidget_hvac_passengerSide_FanSpeed(speed);
-        } catch (const std::exception& e) {
-            qDebug() << "Error converting passenger fan speed value:" << QString::fromStdString(updateValue);
-        }
+    if (!m_verifyWrites) {
+        VAPI_CLIENT.setValues(DK_VAPI_DATABROKER, std::move(batch));
+        return;
     }
+    // the widget was already moved by the page, only fix it up if the broker disagrees
+    SignalHandle handle = VAPI_CLIENT.signalHandle(DK_VAPI_DATABROKER, ValueField::Target, path);
+    VAPI_CLIENT.setValues(DK_VAPI_DATABROKER, std::move(batch),
+        [this, path, handle, expected](const ValueResults &results) {
+            auto it = results.find(path);
+            if (it == results.end() || !it->second.ok) {
+                qDebug() << "Could not verify" << QString::fromStdString(path);
+                return;
+            }
+            qDebug() << "Value verified after setting:" << QString::fromStdString(it->second.value);
+            SignalValue value = it->second.toSignalValue();
+            if (value != expected) {
+                updateWidget(handle, value);
+            }
+        }, this);
 }
 
 void ControlsAsync::qml_setApi_lightCtr_LowBeam(bool sts)
 {
     qDebug() << "Setting low beam to:" << sts;
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, sts);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, sts);
-    
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Bo_Lights_Beam_Low_IsOn,
+                ValueBatch().set(VehicleAPI::V_Bo_Lights_Beam_Low_IsOn, sts),
+                SignalValue(sts));
 }
 
 void ControlsAsync::qml_setApi_lightCtr_HighBeam(bool sts)
 {
     qDebug() << "Setting high beam to:" << sts;
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts);
-    
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Beam_High_IsOn, currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Bo_Lights_Beam_High_IsOn,
+                ValueBatch().set(VehicleAPI::V_Bo_Lights_Beam_High_IsOn, sts),
+                SignalValue(sts));
 }
 
 void ControlsAsync::qml_setApi_lightCtr_Hazard(bool sts)
 {
     qDebug() << "Setting hazard to:" << sts;
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, sts);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, sts);
-    
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Bo_Lights_Hazard_IsSignaling,
+                ValueBatch().set(VehicleAPI::V_Bo_Lights_Hazard_IsSignaling, sts),
+                SignalValue(sts));
 }
 
 void ControlsAsync::qml_setApi_seat_driverSide_position(int position)
@@ -175,43 +160,27 @@ void ControlsAsync::qml_setApi_seat_driverSide_position(int position)
     uint8_t posValue = static_cast<uint8_t>(position);
     
     // Set both CurrentValue and TargetValue
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, 
-                               VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, 
-                               posValue);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, 
-                               VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, 
-                               posValue);
-
-    // Verify the value was set correctly
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, 
-                              VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, 
-                              currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Ca_Seat_R1_DriverSide_Position,
+                ValueBatch().set(VehicleAPI::V_Ca_Seat_R1_DriverSide_Position, posValue),
+                SignalValue(int64_t(position)));
 }
 
 void ControlsAsync::qml_setApi_hvac_driverSide_FanSpeed(uint8_t speed)
 {
     uint8_t scaledSpeed = speed * 10;
     qDebug() << "Setting driver fan speed to:" << speed << "(scaled:" << scaledSpeed << ")";
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, scaledSpeed);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, scaledSpeed);
-    
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed,
+                ValueBatch().set(VehicleAPI::V_Ca_HVAC_Station_R1_Driver_FanSpeed, scaledSpeed),
+                SignalValue(int64_t(scaledSpeed)));
 }
 
 void ControlsAsync::qml_setApi_hvac_passengerSide_FanSpeed(uint8_t speed)
 {
     uint8_t scaledSpeed = speed * 10;
     qDebug() << "Setting passenger fan speed to:" << speed << "(scaled:" << scaledSpeed << ")";
-    VAPI_CLIENT.setCurrentValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, scaledSpeed);
-    VAPI_CLIENT.setTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, scaledSpeed);
-    
-    std::string currentValue;
-    VAPI_CLIENT.getTargetValue(DK_VAPI_DATABROKER, VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, currentValue);
-    qDebug() << "Value verified after setting:" << QString::fromStdString(currentValue);
+    writeValues(VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed,
+                ValueBatch().set(VehicleAPI::V_Ca_HVAC_Station_R1_Passenger_FanSpeed, scaledSpeed),
+                SignalValue(int64_t(scaledSpeed)));
 }
 
 ControlsAsync::~ControlsAsync()
@@ -11,10 +11,17 @@
 #include <QTimer>
 #include <QMap>
 #include "QVariant"
+#include <string>
+#include <vector>
+#include <functional>
+#include "../library/vapiclient/vapiclient.hpp"
+#include "../library/vapiclient/signalupdatequeue.hpp"
 
 class ControlsAsync: public QObject
 {
     Q_OBJECT
+    // read back every write and fix the widget up if the broker did not take it (default on)
+    Q_PROPERTY(bool verifyWrites MEMBER m_verifyWrites)
 public:
     ControlsAsync();
     ~ControlsAsync();
@@ -30,7 +37,7 @@ public:
     Q_INVOKABLE void qml_setApi_hvac_driverSide_FanSpeed(uint8_t speed);
     Q_INVOKABLE void qml_setApi_hvac_passengerSide_FanSpeed(uint8_t speed);
     
-    void vssSubsribeCallback(const std::string &updatePath, const std::string &updateValue); 
+    void vssSubsribeCallback(SignalHandle updateHandle, const SignalValue &updateValue); 
 
 Q_SIGNALS:
     // Lighting signals
@@ -44,6 +51,19 @@ Q_SIGNALS:
     void updateWidget_hvac_passengerSide_FanSpeed(int speed);
 
 private:
+    // registers the widget update of a signal in m_updaters, subscribed by the constructor
+    void bindSignal(const std::string &path, std::function<void(const SignalValue &)> update);
+    // handle -> widget, shared by init() and the subscription
+    void updateWidget(SignalHandle handle, const SignalValue &value);
+    // one non-blocking write of current and target value, verified asynchronously
+    void writeValues(const std::string &path, ValueBatch batch, const SignalValue &expected);
+
+    std::vector<std::string> m_signalPaths;
+    std::vector<SignalHandle> m_signalHandles;
+    // indexed by SignalHandle
+    std::vector<std::function<void(const SignalValue &)>> m_updaters;
+    SignalUpdateQueue *m_updates = nullptr;
+    bool m_verifyWrites = true;
 };
 
 #endif // CONTROLPAGE_H
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "signalupdatequeue.hpp"
+#include <algorithm>
+
+SignalUpdateQueue::SignalUpdateQueue(const std::vector<SignalHandle> &handles, Handler handler,
+                                     int intervalMs, QObject *parent)
+    : QObject(parent)
+    , m_slots(new Slot[handles.size()])
+    , m_handler(std::move(handler))
+    , m_tick(this)
+{
+    SignalHandle maxHandle = 0;
+    for (SignalHandle handle : handles) {
+        maxHandle = std::max(maxHandle, handle);
+    }
+    m_slotIndex.assign(handles.empty() ? 0 : size_t(maxHandle) + 1, -1);
+    for (size_t i = 0; i < handles.size(); ++i) {
+        m_slots[i].handle = handles[i];
+        m_slotIndex[handles[i]] = int32_t(i);
+    }
+
+    m_tick.setSingleShot(true);
+    m_tick.setInterval(intervalMs);
+    connect(&m_tick, &QTimer::timeout, this, &SignalUpdateQueue::drain);
+}
+
+SignalUpdateQueue::~SignalUpdateQueue()
+{
+    for (size_t i = 0; i < m_slotIndex.size(); ++i) {
+        if (m_slotIndex[i] >= 0) {
+            delete m_slots[m_slotIndex[i]].latest.exchange(nullptr);
+        }
+    }
+}
+
+void SignalUpdateQueue::post(SignalHandle handle, SignalValue value)
+{
+    if (handle >= m_slotIndex.size() || m_slotIndex[handle] < 0) {
+        return;
+    }
+    Slot &slot = m_slots[m_slotIndex[handle]];
+    m_posted.fetch_add(1, std::memory_order_relaxed);
+
+    SignalValue *previous = slot.latest.exchange(new SignalValue(std::move(value)), std::memory_order_acq_rel);
+    if (previous) {
+        // not delivered yet, the new value wins
+        delete previous;
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (slot.dirty.exchange(true, std::memory_order_acq_rel)) {
+        return; // already on the stack
+    }
+    Slot *head = m_dirty.load(std::memory_order_relaxed);
+    do {
+        slot.next = head;
+    } while (!m_dirty.compare_exchange_weak(head, &slot, std::memory_order_release, std::memory_order_relaxed));
+
+    wake();
+}
+
+void SignalUpdateQueue::wake()
+{
+    // one queued event per tick at most, however many threads post
+    if (m_armed.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    QMetaObject::invokeMethod(this, [this]() {
+        if (!m_tick.isActive()) {
+            m_tick.start();
+        }
+    }, Qt::QueuedConnection);
+}
+
+void SignalUpdateQueue::drain()
+{
+    // disarm first: a post from here on queues the next tick
+    m_armed.store(false, std::memory_order_release);
+
+    Slot *slot = m_dirty.exchange(nullptr, std::memory_order_acquire);
+    while (slot) {
+        Slot *next = slot->next;
+        // clear before taking the value, so a post racing with us pushes the slot again
+        slot->dirty.store(false, std::memory_order_release);
+        std::unique_ptr<SignalValue> value(slot->latest.exchange(nullptr, std::memory_order_acq_rel));
+        if (value) {
+            m_delivered.fetch_add(1, std::memory_order_relaxed);
+            m_handler(slot->handle, *value);
+        }
+        slot = next;
+    }
+}
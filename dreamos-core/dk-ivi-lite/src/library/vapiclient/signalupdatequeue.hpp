@@ -0,0 +1,74 @@
+#ifndef SIGNAL_UPDATE_QUEUE_HPP
+#define SIGNAL_UPDATE_QUEUE_HPP
+
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "vapiclient.hpp"
+
+//------------------------------------------------------------------------------
+// SignalUpdateQueue
+//
+// Hands subscription updates from the VAPI threads to the thread of the queue
+// (the GUI thread). post() is lock-free and may be called from any number of
+// threads; each signal keeps only its latest value, so a signal that changes
+// a hundred times between two drains is delivered once. The handler runs on the
+// queue's thread at most once per signal every intervalMs, no matter how fast
+// the updates come in, and nothing runs while no signal changes.
+//------------------------------------------------------------------------------
+class SignalUpdateQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Handler = std::function<void(SignalHandle handle, const SignalValue &value)>;
+
+    // handles: the signals this queue carries, posts of any other handle are dropped.
+    SignalUpdateQueue(const std::vector<SignalHandle> &handles, Handler handler,
+                      int intervalMs = 16, QObject *parent = nullptr);
+    ~SignalUpdateQueue();
+
+    // Any thread. Replaces the pending value of handle, if there is one.
+    void post(SignalHandle handle, SignalValue value);
+
+    // Delivers the pending values now; called by the tick, on the queue's thread.
+    void drain();
+
+    uint64_t postedCount() const { return m_posted.load(std::memory_order_relaxed); }
+    uint64_t coalescedCount() const { return m_coalesced.load(std::memory_order_relaxed); }
+    uint64_t deliveredCount() const { return m_delivered.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        SignalHandle handle = kInvalidSignalHandle;
+        // owned by whoever exchanges it out: post() for a replaced value, drain() otherwise
+        std::atomic<SignalValue *> latest{nullptr};
+        // set while the slot is on the dirty stack
+        std::atomic<bool> dirty{false};
+        Slot *next = nullptr;
+    };
+
+    void wake();
+
+    // both fixed after construction, so post() can read them without a lock
+    std::unique_ptr<Slot[]> m_slots;
+    std::vector<int32_t> m_slotIndex; // SignalHandle -> m_slots index, -1 if not carried
+
+    // Treiber stack of dirty slots; drain() takes the whole stack at once, so no ABA
+    std::atomic<Slot *> m_dirty{nullptr};
+    // a wake-up is queued or the tick is running
+    std::atomic<bool> m_armed{false};
+
+    Handler m_handler;
+    QTimer m_tick;
+
+    std::atomic<uint64_t> m_posted{0};
+    std::atomic<uint64_t> m_coalesced{0};
+    std::atomic<uint64_t> m_delivered{0};
+};
+
+#endif // SIGNAL_UPDATE_QUEUE_HPP
@@ -0,0 +1,205 @@
+#include "signalvalue.hpp"
+#include <charconv>
+#include <limits>
+
+namespace VAPI {
+
+namespace {
+
+const char *skipSpace(const char *first, const char *last) {
+    while (first != last && (*first == ' ' || *first == '\t' || *first == '\n' || *first == '\r')) {
+        ++first;
+    }
+    return first;
+}
+
+const char *trimSpace(const char *first, const char *last) {
+    while (last != first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\n' || last[-1] == '\r')) {
+        --last;
+    }
+    return last;
+}
+
+// The whole [first, last) must be the number, from_chars does not allocate or use the locale.
+template<typename T>
+bool parseNumber(const char *first, const char *last, T &out) {
+    if (first == last) {
+        return false;
+    }
+    if (*first == '+') {
+        ++first;
+    }
+    auto result = std::from_chars(first, last, out);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+SignalValue::Data parseScalar(const char *first, const char *last) {
+    first = skipSpace(first, last);
+    last = trimSpace(first, last);
+    size_t len = last - first;
+    if (len == 0) {
+        return std::monostate();
+    }
+    if (len == 4 && std::char_traits<char>::compare(first, "true", 4) == 0) {
+        return true;
+    }
+    if (len == 5 && std::char_traits<char>::compare(first, "false", 5) == 0) {
+        return false;
+    }
+    int64_t i = 0;
+    if (parseNumber(first, last, i)) {
+        return i;
+    }
+    uint64_t u = 0;
+    if (parseNumber(first, last, u)) {
+        return u;
+    }
+    double d = 0.0;
+    if (parseNumber(first, last, d)) {
+        return d;
+    }
+    // quoted string elements of an array
+    if (len >= 2 && (*first == '"' || *first == '\'') && last[-1] == *first) {
+        return std::string(first + 1, last - 1);
+    }
+    return std::string(first, last);
+}
+
+// "[a, b, c]": one vector kind for all elements, the widest one they need.
+SignalValue::Data parseArray(const char *first, const char *last) {
+    std::vector<SignalValue::Data> items;
+    std::vector<std::string> texts;
+    const char *item = first;
+    for (const char *p = first; p <= last; ++p) {
+        if (p == last || *p == ',') {
+            const char *begin = skipSpace(item, p);
+            if (begin != p) {
+                items.push_back(parseScalar(begin, p));
+                texts.emplace_back(begin, trimSpace(begin, p));
+            }
+            item = p + 1;
+        }
+    }
+
+    bool allBool = true, allInt = true, allNumber = true;
+    for (const auto &v : items) {
+        allBool = allBool && std::holds_alternative<bool>(v);
+        allInt = allInt && std::holds_alternative<int64_t>(v);
+        allNumber = allNumber && (std::holds_alternative<int64_t>(v) || std::holds_alternative<uint64_t>(v) ||
+                                  std::holds_alternative<double>(v));
+    }
+    if (items.empty()) {
+        return std::vector<std::string>();
+    }
+    if (allBool) {
+        std::vector<bool> out;
+        for (const auto &v : items) out.push_back(std::get<bool>(v));
+        return out;
+    }
+    if (allInt) {
+        std::vector<int64_t> out;
+        for (const auto &v : items) out.push_back(std::get<int64_t>(v));
+        return out;
+    }
+    if (allNumber) {
+        std::vector<double> out;
+        for (const auto &v : items) {
+            if (std::holds_alternative<int64_t>(v)) out.push_back(double(std::get<int64_t>(v)));
+            else if (std::holds_alternative<uint64_t>(v)) out.push_back(double(std::get<uint64_t>(v)));
+            else out.push_back(std::get<double>(v));
+        }
+        return out;
+    }
+    // mixed kinds, keep the elements as they were written (quotes removed)
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (std::holds_alternative<std::string>(items[i])) {
+            texts[i] = std::move(std::get<std::string>(items[i]));
+        }
+    }
+    return texts;
+}
+
+template<typename T>
+void appendNumber(std::string &out, T value) {
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, result.ptr);
+}
+
+struct Formatter {
+    std::string &out;
+    void operator()(std::monostate) {}
+    void operator()(bool b) { out += b ? "true" : "false"; }
+    void operator()(int64_t i) { appendNumber(out, i); }
+    void operator()(uint64_t u) { appendNumber(out, u); }
+    void operator()(double d) { appendNumber(out, d); }
+    void operator()(const std::string &s) { out += s; }
+    template<typename T>
+    void operator()(const std::vector<T> &items) {
+        out += '[';
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i) out += ", ";
+            (*this)(static_cast<T>(items[i]));
+        }
+        out += ']';
+    }
+};
+
+} // namespace
+
+SignalValue SignalValue::parse(const std::string &text, Clock::time_point received) {
+    SignalValue value;
+    value.mReceived = received;
+    const char *first = skipSpace(text.data(), text.data() + text.size());
+    const char *last = trimSpace(first, text.data() + text.size());
+    if (last - first >= 2 && *first == '[' && last[-1] == ']') {
+        value.mData = parseArray(first + 1, last - 1);
+    } else {
+        value.mData = parseScalar(first, last);
+    }
+    return value;
+}
+
+bool SignalValue::isNumber() const {
+    return std::holds_alternative<int64_t>(mData) || std::holds_alternative<uint64_t>(mData) ||
+           std::holds_alternative<double>(mData);
+}
+
+bool SignalValue::isArray() const {
+    return std::holds_alternative<std::vector<bool>>(mData) || std::holds_alternative<std::vector<int64_t>>(mData) ||
+           std::holds_alternative<std::vector<double>>(mData) || std::holds_alternative<std::vector<std::string>>(mData);
+}
+
+bool SignalValue::toBool(bool fallback) const {
+    if (auto b = std::get_if<bool>(&mData)) return *b;
+    if (auto i = std::get_if<int64_t>(&mData)) return *i != 0;
+    if (auto u = std::get_if<uint64_t>(&mData)) return *u != 0;
+    if (auto d = std::get_if<double>(&mData)) return *d != 0.0;
+    return fallback;
+}
+
+int64_t SignalValue::toInt(int64_t fallback) const {
+    if (auto i = std::get_if<int64_t>(&mData)) return *i;
+    if (auto u = std::get_if<uint64_t>(&mData)) {
+        return *u > uint64_t(std::numeric_limits<int64_t>::max()) ? std::numeric_limits<int64_t>::max() : int64_t(*u);
+    }
+    if (auto d = std::get_if<double>(&mData)) return int64_t(*d);
+    if (auto b = std::get_if<bool>(&mData)) return *b ? 1 : 0;
+    return fallback;
+}
+
+double SignalValue::toDouble(double fallback) const {
+    if (auto d = std::get_if<double>(&mData)) return *d;
+    if (auto i = std::get_if<int64_t>(&mData)) return double(*i);
+    if (auto u = std::get_if<uint64_t>(&mData)) return double(*u);
+    if (auto b = std::get_if<bool>(&mData)) return *b ? 1.0 : 0.0;
+    return fallback;
+}
+
+std::string SignalValue::toString() const {
+    std::string out;
+    std::visit(Formatter{out}, mData);
+    return out;
+}
+
+} // namespace VAPI
@@ -0,0 +1,69 @@
+#ifndef SIGNAL_VALUE_HPP
+#define SIGNAL_VALUE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace VAPI {
+
+//------------------------------------------------------------------------------
+// SignalValue
+//
+// A databroker value as a tagged variant, parsed once when the update arrives so
+// consumers switch on the type instead of calling std::stoi / comparing "true".
+// KuksaClient hands values over as text without a type, so the type is inferred:
+// true/false, integers (signed, or unsigned above INT64_MAX), floating point,
+// "[a, b, ...]" arrays of those, anything else stays a string.
+//------------------------------------------------------------------------------
+class SignalValue {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Data = std::variant<std::monostate,
+                              bool,
+                              int64_t,
+                              uint64_t,
+                              double,
+                              std::string,
+                              std::vector<bool>,
+                              std::vector<int64_t>,
+                              std::vector<double>,
+                              std::vector<std::string>>;
+
+    SignalValue() = default;
+    explicit SignalValue(Data data, Clock::time_point received = Clock::now())
+        : mData(std::move(data)), mReceived(received) {}
+
+    static SignalValue parse(const std::string &text, Clock::time_point received = Clock::now());
+
+    const Data &data() const { return mData; }
+    // When dk_ivi received the update (KuksaClient does not pass the broker timestamp on).
+    Clock::time_point received() const { return mReceived; }
+
+    bool isValid() const { return !std::holds_alternative<std::monostate>(mData); }
+    bool isBool() const { return std::holds_alternative<bool>(mData); }
+    bool isNumber() const;
+    bool isString() const { return std::holds_alternative<std::string>(mData); }
+    bool isArray() const;
+
+    // Conversions between the scalar kinds, fallback for anything else.
+    bool toBool(bool fallback = false) const;
+    int64_t toInt(int64_t fallback = 0) const;
+    double toDouble(double fallback = 0.0) const;
+    // Formats the value; for logging and the string callback adapter, not the hot path.
+    std::string toString() const;
+
+    bool operator==(const SignalValue &other) const { return mData == other.mData; }
+    bool operator!=(const SignalValue &other) const { return !(*this == other); }
+
+private:
+    Data mData;
+    Clock::time_point mReceived;
+};
+
+} // namespace VAPI
+
+#endif // SIGNAL_VALUE_HPP
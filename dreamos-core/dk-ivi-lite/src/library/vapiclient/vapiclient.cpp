@@ -1,39 +1,241 @@
 #include "vapiclient.hpp"
+#include <future>
+#include <cmath>
+#include <algorithm>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <cerrno>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
 
 namespace VAPI {
 
+namespace {
+
+// Whether a TCP connection to serverURI ("host:port") can be opened within timeoutMs.
+// The transport level liveness of a broker: unlike a get it doesn't depend on the
+// probed signal having a value.
+bool tcpReachable(const std::string &serverURI, int timeoutMs)
+{
+    size_t colon = serverURI.rfind(':');
+    if (colon == std::string::npos) {
+        return false;
+    }
+    std::string host = serverURI.substr(0, colon);
+    std::string port = serverURI.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+    bool reachable = false;
+    for (addrinfo *address = addresses; address && !reachable; address = address->ai_next) {
+        int fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            reachable = true;
+        } else if (errno == EINPROGRESS) {
+            pollfd pfd{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            reachable = poll(&pfd, 1, timeoutMs) == 1 &&
+                        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+        }
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+    return reachable;
+}
+
+} // namespace
+
+TaskQueue::~TaskQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCv.notify_all();
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+}
+
+void TaskQueue::push(std::function<void()> job) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    while (mThreads.size() < mThreadCount) {
+        mThreads.emplace_back(&TaskQueue::loop, this);
+    }
+    mJobs.push_back(std::move(job));
+    mCv.notify_one();
+}
+
+void TaskQueue::loop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mCv.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+        if (mStopping) {
+            return;
+        }
+        auto job = std::move(mJobs.front());
+        mJobs.pop_front();
+        lock.unlock();
+        job();
+        lock.lock();
+    }
+}
+
+UpdateFilter::UpdateFilter(const SubscribeOptions &options)
+    : mOptions(options) {
+    if (options.maxRateHz > 0.0) {
+        mMinInterval = std::chrono::duration_cast<SignalValue::Clock::duration>(
+            std::chrono::duration<double>(1.0 / options.maxRateHz));
+    }
+}
+
+UpdateFilter::Result UpdateFilter::accept(const SignalValue &value, const std::string &raw,
+                                          SignalValue::Clock::time_point &flushAt) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mHasLast) {
+        // value is the newest now: if it is dropped as too close to the last delivered one,
+        // a value held back before it is outdated as well
+        if (mOptions.onChangeOnly && value == mLast) {
+            mHasPending = false;
+            return Result::Drop;
+        }
+        if (mOptions.deadband > 0.0 && value.isNumber() && mLast.isNumber() &&
+            std::fabs(value.toDouble() - mLast.toDouble()) < mOptions.deadband) {
+            mHasPending = false;
+            return Result::Drop;
+        }
+        if (mMinInterval.count() > 0 && value.received() - mLastAt < mMinInterval) {
+            bool first = !mHasPending;
+            mHasPending = true;
+            mPending = value;
+            mPendingRaw = raw;
+            flushAt = mLastAt + mMinInterval;
+            return first ? Result::Defer : Result::Drop;
+        }
+    }
+    mHasLast = true;
+    mLast = value;
+    mLastAt = value.received();
+    mHasPending = false;
+    return Result::Deliver;
+}
+
+bool UpdateFilter::takePending(SignalValue &value, std::string &raw) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mHasPending) {
+        return false;
+    }
+    mHasPending = false;
+    mLast = mPending;
+    mLastAt = SignalValue::Clock::now();
+    value = std::move(mPending);
+    raw = std::move(mPendingRaw);
+    return true;
+}
+
 VAPIClient::VAPIClient() {
     // Initially, no connections are set up.
 }
 
 VAPIClient::~VAPIClient() {
+    {
+        std::lock_guard<std::mutex> lock(mSuperviseMutex);
+        mSuperviseStopping = true;
+    }
+    mSuperviseCv.notify_all();
+    if (mSupervisor.joinable()) {
+        mSupervisor.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mFlushMutex);
+        mFlushStopping = true;
+    }
+    mFlushCv.notify_all();
+    if (mFlusher.joinable()) {
+        mFlusher.join();
+    }
+    {
+        // the streams still run, don't wait for them on exit
+        std::lock_guard<std::mutex> lock(mSubscriptionMutex);
+        for (auto &entry : mSubscriptionManagers) {
+            entry.second.manager->detachAll();
+        }
+    }
     // All DataBrokerClient instances will be destroyed automatically.
 }
 
 void VAPIClient::connectToServer(const std::string &serverURI) {
     // Only connect if a client for serverURI does not already exist.
-    if (mClients.find(serverURI) == mClients.end()) {
-        auto client = std::make_unique<KuksaClient::DataBrokerClient>();
+    std::promise<void> connected;
+    auto client = addClient(serverURI, connected.get_future().share());
+    if (client) {
         client->Connect(serverURI);
         client->GetServerInfo();
-        mClients[serverURI] = std::move(client);
+        connected.set_value();
         std::cout << "Connected to server " << serverURI << std::endl;
+        setConnectionState(serverURI, ConnectionState::Connected);
+        startSupervisor();
     } else {
         std::cout << "Already connected to " << serverURI << std::endl;
     }
 }
 
-KuksaClient::DataBrokerClient* VAPIClient::getClient(const std::string &serverURI) {
-    auto it = mClients.find(serverURI);
-    if (it != mClients.end()) {
-        return it->second.get();
+KuksaClient::DataBrokerClient* VAPIClient::addClient(const std::string &serverURI, std::shared_future<void> ready) {
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    if (mClients.find(serverURI) != mClients.end()) {
+        return nullptr;
+    }
+    ClientEntry &entry = mClients[serverURI];
+    entry.client = std::make_shared<KuksaClient::DataBrokerClient>();
+    entry.ready = std::move(ready);
+    return entry.client.get();
+}
+
+KuksaClient::DataBrokerClient* VAPIClient::getClient(const std::string &serverURI,
+    std::shared_ptr<std::atomic<uint64_t>> *generation, uint64_t *clientGeneration,
+    std::shared_ptr<KuksaClient::DataBrokerClient> *owner) {
+    std::shared_future<void> ready;
+    {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        auto it = mClients.find(serverURI);
+        if (it == mClients.end()) {
+            return nullptr;
+        }
+        ready = it->second.ready;
+    }
+    ready.wait();
+    // read after the wait, a reconnect may have replaced the client meanwhile
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    const ClientEntry &entry = mClients[serverURI];
+    if (generation) {
+        *generation = entry.generation;
     }
-    return nullptr;
+    if (clientGeneration) {
+        *clientGeneration = entry.generation->load();
+    }
+    if (owner) {
+        *owner = entry.client;
+    }
+    return entry.client.get();
 }
 
 bool VAPIClient::getCurrentValue(const std::string &serverURI,
                                  const std::string &path,
                                  std::string &value) {
+    if (shadowValue(serverURI, ValueField::Current, path, value)) {
+        return true;
+    }
     auto client = getClient(serverURI);
     if (client) {
         return client->GetCurrentValue(path, value);
@@ -46,6 +248,9 @@ bool VAPIClient::getCurrentValue(const std::string &serverURI,
 bool VAPIClient::getTargetValue(const std::string &serverURI,
     const std::string &path,
     std::string &value) {
+    if (shadowValue(serverURI, ValueField::Target, path, value)) {
+        return true;
+    }
     auto client = getClient(serverURI);
     if (client) {
         return client->GetTargetValue(path, value);
@@ -55,35 +260,685 @@ bool VAPIClient::getTargetValue(const std::string &serverURI,
     }
 }
 
-// Inside VAPIClient::subscribe
-void VAPIClient::subscribe(const std::string &serverURI,
-    const std::vector<std::string> &signalPaths,
-    const KuksaClient::DataBrokerClient::Callback &userCallback) {
+ValueResults VAPIClient::getValues(const std::string &serverURI,
+    const std::vector<std::string> &paths,
+    ValueField field) {
+    ValueResults results;
+    std::vector<std::string> missing;
+    for (const auto &path : paths) {
+        ValueResult &result = results[path];
+        result.ok = shadowValue(serverURI, field, path, result.value);
+        if (!result.ok) {
+            missing.push_back(path);
+        }
+    }
+    if (missing.size() == paths.size()) {
+        return fetchValues(serverURI, paths, field);
+    }
+    for (auto &fetched : fetchValues(serverURI, missing, field)) {
+        results[fetched.first] = std::move(fetched.second);
+    }
+    return results;
+}
 
+ValueResults VAPIClient::fetchValues(const std::string &serverURI,
+    const std::vector<std::string> &paths,
+    ValueField field) {
+    ValueResults results;
     auto client = getClient(serverURI);
-    if (client) {
-        auto subManager = std::make_unique<KuksaClient::SubscriptionManager>(*client, signalPaths);
-        subManager->startSubscriptions(userCallback);
-        subManager->detachAll();
-        mSubscriptionManagers.push_back({std::move(subManager)});
-    } else {
+    if (!client) {
+        std::cerr << "Client for server " << serverURI << " not found." << std::endl;
+        for (const auto &path : paths) {
+            results[path] = ValueResult();
+        }
+        return results;
+    }
+
+    // DataBrokerClient only has single path gets, the gRPC channel underneath
+    // is thread safe, so issue them side by side instead of one after the other,
+    // at most kFetchThreads at a time whatever the size of the request.
+    std::vector<std::future<ValueResult>> pending;
+    pending.reserve(paths.size());
+    for (const auto &path : paths) {
+        auto get = std::make_shared<std::packaged_task<ValueResult()>>([client, path, field]() {
+            ValueResult result;
+            if (field == ValueField::Current) {
+                result.ok = client->GetCurrentValue(path, result.value);
+            } else {
+                result.ok = client->GetTargetValue(path, result.value);
+            }
+            return result;
+        });
+        pending.push_back(get->get_future());
+        mFetchers.push([get]() { (*get)(); });
+    }
+    for (size_t i = 0; i < paths.size(); ++i) {
+        results[paths[i]] = pending[i].get();
+    }
+    return results;
+}
+
+template<typename Result>
+std::shared_future<Result> VAPIClient::runAsync(TaskQueue &queue, std::function<Result()> call, Result failed,
+    QObject *context, Completion<Result> done, int timeoutMs) {
+    struct CallState {
+        std::promise<Result> promise;
+        std::atomic<bool> settled{false};
+    };
+    auto state = std::make_shared<CallState>();
+    std::shared_future<Result> future = state->promise.get_future().share();
+
+    // The relay lives on the caller's thread until the single delivery (result or
+    // deadline, whichever comes first) ran there; context is only checked on that thread.
+    QObject *relay = context ? new QObject() : nullptr;
+    QPointer<QObject> guard(context);
+
+    auto settle = [state, relay, guard, done](const Result &result) {
+        if (state->settled.exchange(true)) {
+            return;
+        }
+        state->promise.set_value(result);
+        if (!relay) {
+            if (done) {
+                done(result);
+            }
+            return;
+        }
+        QMetaObject::invokeMethod(relay, [relay, guard, done, result]() {
+            if (done && guard) {
+                done(result);
+            }
+            relay->deleteLater();
+        }, Qt::QueuedConnection);
+    };
+
+    if (relay) {
+        QTimer::singleShot(timeoutMs, relay, [settle, failed]() {
+            settle(failed);
+        });
+    }
+    queue.push([call, settle]() {
+        settle(call());
+    });
+    return future;
+}
+
+std::shared_future<bool> VAPIClient::connectToServerAsync(const std::string &serverURI,
+    QObject *context, Completion<bool> done, int timeoutMs) {
+    auto connected = std::make_shared<std::promise<void>>();
+    auto client = addClient(serverURI, connected->get_future().share());
+    if (!client) {
+        // connected or connecting already, resolve once it is usable
+        return runAsync<bool>(mWorkers, [this, serverURI]() {
+            return getClient(serverURI) != nullptr;
+        }, false, context, done, timeoutMs);
+    }
+    return runAsync<bool>(mWorkers, [this, client, serverURI, connected]() {
+        client->Connect(serverURI);
+        client->GetServerInfo();
+        connected->set_value();
+        std::cout << "Connected to server " << serverURI << std::endl;
+        setConnectionState(serverURI, ConnectionState::Connected);
+        startSupervisor();
+        return true;
+    }, false, context, done, timeoutMs);
+}
+
+std::shared_future<ValueResult> VAPIClient::getCurrentValueAsync(const std::string &serverURI,
+    const std::string &path, QObject *context, Completion<ValueResult> done, int timeoutMs) {
+    ValueResult failed;
+    failed.timedOut = true;
+    return runAsync<ValueResult>(mWorkers, [this, serverURI, path]() {
+        ValueResult result;
+        result.ok = getCurrentValue(serverURI, path, result.value);
+        return result;
+    }, failed, context, done, timeoutMs);
+}
+
+std::shared_future<ValueResult> VAPIClient::getTargetValueAsync(const std::string &serverURI,
+    const std::string &path, QObject *context, Completion<ValueResult> done, int timeoutMs) {
+    ValueResult failed;
+    failed.timedOut = true;
+    return runAsync<ValueResult>(mWorkers, [this, serverURI, path]() {
+        ValueResult result;
+        result.ok = getTargetValue(serverURI, path, result.value);
+        return result;
+    }, failed, context, done, timeoutMs);
+}
+
+std::shared_future<ValueResults> VAPIClient::getValuesAsync(const std::string &serverURI,
+    const std::vector<std::string> &paths, ValueField field,
+    QObject *context, Completion<ValueResults> done, int timeoutMs) {
+    ValueResults failed;
+    for (const auto &path : paths) {
+        failed[path].timedOut = true;
+    }
+    return runAsync<ValueResults>(mWorkers, [this, serverURI, paths, field]() {
+        return getValues(serverURI, paths, field);
+    }, failed, context, done, timeoutMs);
+}
+
+std::shared_future<ValueResults> VAPIClient::setValues(const std::string &serverURI, ValueBatch batch,
+    VerifyCallback verify, QObject *context, int timeoutMs) {
+    ValueResults failed;
+    for (const auto &path : batch.mPaths) {
+        failed[path].timedOut = true;
+    }
+    bool readBack = static_cast<bool>(verify);
+    return runAsync<ValueResults>(mWriter, [this, serverURI, batch = std::move(batch), readBack]() {
+        auto client = getClient(serverURI);
+        if (!client) {
+            std::cerr << "Client for server " << serverURI << " not found." << std::endl;
+            return ValueResults();
+        }
+        // the cached values of the batch are about to be outdated
+        for (const auto &path : batch.mPaths) {
+            invalidateShadow(serverURI, path);
+        }
+        std::vector<std::future<void>> pending;
+        pending.reserve(batch.mWrites.size());
+        for (const auto &write : batch.mWrites) {
+            pending.push_back(std::async(std::launch::async, [client, &write]() {
+                write(*client);
+            }));
+        }
+        for (auto &done : pending) {
+            done.get();
+        }
+        if (!readBack) {
+            return ValueResults();
+        }
+        // what the broker has now, not what a subscription reported before the write
+        return fetchValues(serverURI, batch.mPaths, ValueField::Target);
+    }, failed, context, verify, timeoutMs);
+}
+
+std::string VAPIClient::hubKey(const std::string &serverURI, ValueField field, const std::string &path) {
+    return serverURI + (field == ValueField::Current ? "|c|" : "|t|") + path;
+}
+
+SignalHandle VAPIClient::internLocked(const std::string &serverURI, ValueField field, const std::string &path) {
+    auto inserted = mHandles.emplace(hubKey(serverURI, field, path), SignalHandle(mSlots.size()));
+    if (inserted.second) {
+        mSlots.push_back({serverURI, path, field, nullptr});
+    }
+    return inserted.first->second;
+}
+
+SignalHandle VAPIClient::signalHandle(const std::string &serverURI, ValueField field, const std::string &path) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    return internLocked(serverURI, field, path);
+}
+
+std::string VAPIClient::signalPath(SignalHandle handle) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    return handle < mSlots.size() ? mSlots[handle].path : std::string();
+}
+
+std::vector<SignalHandle> VAPIClient::internPaths(const std::string &serverURI, ValueField field,
+    const std::vector<std::string> &paths) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    std::vector<SignalHandle> handles;
+    handles.reserve(paths.size());
+    for (const auto &path : paths) {
+        handles.push_back(internLocked(serverURI, field, path));
+    }
+    return handles;
+}
+
+void VAPIClient::addSubscription(const std::vector<SignalHandle> &handles, const Consumer &consumer,
+    const SubscribeOptions &options) {
+
+    std::vector<std::pair<SignalHandle, HubSlot>> newSlots;
+    {
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        for (SignalHandle handle : handles) {
+            if (handle >= mSlots.size()) {
+                std::cerr << "Unknown signal handle " << handle << ": cannot subscribe." << std::endl;
+                continue;
+            }
+            HubSlot &slot = mSlots[handle];
+            auto consumers = slot.consumers ? std::make_shared<Consumers>(*slot.consumers)
+                                            : std::make_shared<Consumers>();
+            if (!slot.consumers) {
+                newSlots.push_back({handle, slot});
+            }
+            Consumer added = consumer;
+            if (options.filters()) {
+                added.filter = std::make_shared<UpdateFilter>(options);
+            }
+            consumers->needsPath = consumers->needsPath || added.onString || added.onValue;
+            consumers->needsValue = consumers->needsValue || !added.onString || added.filter;
+            consumers->list.push_back(std::move(added));
+            slot.consumers = consumers;
+        }
+    }
+    if (newSlots.empty()) {
+        return;
+    }
+
+    mWorkers.push([this, newSlots]() {
+        for (const auto &entry : newSlots) {
+            startUpstream(entry.first);
+        }
+    });
+}
+
+void VAPIClient::startUpstream(SignalHandle handle) {
+    std::string serverURI, path;
+    ValueField field;
+    {
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        serverURI = mSlots[handle].serverURI;
+        path = mSlots[handle].path;
+        field = mSlots[handle].field;
+    }
+    std::shared_ptr<std::atomic<uint64_t>> generation;
+    uint64_t clientGeneration = 0;
+    std::shared_ptr<KuksaClient::DataBrokerClient> owner;
+    auto client = getClient(serverURI, &generation, &clientGeneration, &owner);
+    if (!client) {
         std::cerr << "Client for server " << serverURI << " not found: cannot subscribe." << std::endl;
+        return;
+    }
+    {
+        // a reconnect and a new subscription can both get here for the same slot
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        if (mSlots[handle].upstreamGeneration == int64_t(clientGeneration)) {
+            return;
+        }
+        mSlots[handle].upstreamGeneration = int64_t(clientGeneration);
+    }
+
+    // One manager per path (SubscriptionManager runs a thread per path either way),
+    // so the update callback already knows its handle.
+    auto hubCallback = [this, handle, generation, clientGeneration](const std::string &, const std::string &value) {
+        if (generation->load(std::memory_order_relaxed) != clientGeneration) {
+            return; // stream of a client replaced by a reconnect
+        }
+        dispatch(handle, value);
+    };
+    auto subManager = std::make_unique<KuksaClient::SubscriptionManager>(*client, std::vector<std::string>{path});
+    if (field == ValueField::Current) {
+        subManager->startSubscriptions(hubCallback);
+    } else {
+        subManager->startTargetSubscriptions(hubCallback);
+    }
+    SubscriptionEntry replaced;
+    {
+        std::lock_guard<std::mutex> lock(mSubscriptionMutex);
+        SubscriptionEntry &entry = mSubscriptionManagers[handle];
+        replaced = std::move(entry);
+        entry.client = std::move(owner);
+        entry.manager = std::move(subManager);
     }
+    if (replaced.manager) {
+        retireSubscription(std::move(replaced));
+    }
+}
+
+void VAPIClient::retireSubscription(SubscriptionEntry entry) {
+    // the stream of a replaced client ends with the connection it lost; the thread
+    // exits right after, releasing the manager and, with its last stream, the client
+    std::thread([entry = std::move(entry)]() {
+        entry.manager->joinAll();
+    }).detach();
+}
+
+void VAPIClient::dispatch(SignalHandle handle, const std::string &value) {
+    std::shared_ptr<const Consumers> consumers;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        HubSlot &slot = mSlots[handle];
+        slot.hasLatest = true;
+        slot.latest = value;
+        slot.latestAt = SignalValue::Clock::now();
+        consumers = slot.consumers;
+        if (consumers->needsPath) {
+            path = mSlots[handle].path;
+        }
+    }
+    // parsed once for all typed consumers and filters of the slot
+    SignalValue typed;
+    if (consumers->needsValue) {
+        typed = SignalValue::parse(value);
+    }
+    for (const auto &consumer : consumers->list) {
+        if (consumer.filter) {
+            SignalValue::Clock::time_point flushAt;
+            UpdateFilter::Result result = consumer.filter->accept(typed, value, flushAt);
+            if (result == UpdateFilter::Result::Defer) {
+                scheduleFlush(flushAt, handle, consumer);
+            }
+            if (result != UpdateFilter::Result::Deliver) {
+                continue;
+            }
+        }
+        deliver(consumer, handle, path, value, typed);
+    }
+}
+
+void VAPIClient::deliver(const Consumer &consumer, SignalHandle handle, const std::string &path,
+                         const std::string &raw, const SignalValue &typed) {
+    if (consumer.onString) {
+        consumer.onString(path, raw);
+    } else if (consumer.onValue) {
+        consumer.onValue(path, typed);
+    } else {
+        consumer.onHandle(handle, typed);
+    }
+}
+
+void VAPIClient::scheduleFlush(SignalValue::Clock::time_point at, SignalHandle handle, const Consumer &consumer) {
+    std::lock_guard<std::mutex> lock(mFlushMutex);
+    if (mFlushStopping) {
+        return;
+    }
+    if (!mFlusher.joinable()) {
+        mFlusher = std::thread(&VAPIClient::flushLoop, this);
+    }
+    bool earliest = mFlushes.empty() || at < mFlushes.begin()->first;
+    mFlushes.emplace(at, PendingFlush{handle, consumer});
+    if (earliest) {
+        mFlushCv.notify_one();
+    }
+}
+
+void VAPIClient::flushLoop() {
+    std::unique_lock<std::mutex> lock(mFlushMutex);
+    while (!mFlushStopping) {
+        if (mFlushes.empty()) {
+            mFlushCv.wait(lock);
+            continue;
+        }
+        auto due = mFlushes.begin()->first;
+        if (SignalValue::Clock::now() < due) {
+            mFlushCv.wait_until(lock, due);
+            continue;
+        }
+        PendingFlush flush = std::move(mFlushes.begin()->second);
+        mFlushes.erase(mFlushes.begin());
+        lock.unlock();
+
+        SignalValue typed;
+        std::string raw;
+        if (flush.consumer.filter->takePending(typed, raw)) {
+            std::string path;
+            if (!flush.consumer.onHandle) {
+                std::lock_guard<std::mutex> hubLock(mHubMutex);
+                path = mSlots[flush.handle].path;
+            }
+            deliver(flush.consumer, flush.handle, path, raw, typed);
+        }
+        lock.lock();
+    }
+}
+
+void VAPIClient::subscribe(const std::string &serverURI,
+    const std::vector<std::string> &signalPaths,
+    const KuksaClient::DataBrokerClient::Callback &userCallback,
+    const SubscribeOptions &options) {
+    Consumer consumer;
+    consumer.onString = userCallback;
+    addSubscription(internPaths(serverURI, ValueField::Current, signalPaths), consumer, options);
 }
 
 void VAPIClient::subscribeTarget(const std::string &serverURI,
     const std::vector<std::string> &signalPaths,
-    const KuksaClient::DataBrokerClient::Callback &userCallback) {
+    const KuksaClient::DataBrokerClient::Callback &userCallback,
+    const SubscribeOptions &options) {
+    Consumer consumer;
+    consumer.onString = userCallback;
+    addSubscription(internPaths(serverURI, ValueField::Target, signalPaths), consumer, options);
+}
 
-    auto client = getClient(serverURI);
-    if (client) {
-        auto subManager = std::make_unique<KuksaClient::SubscriptionManager>(*client, signalPaths);
-        subManager->startTargetSubscriptions(userCallback);
-        subManager->detachAll();
-        mSubscriptionManagers.push_back({std::move(subManager)});
-    } else {
-        std::cerr << "Client for server " << serverURI << " not found: cannot subscribe." << std::endl;
+void VAPIClient::subscribeValues(const std::string &serverURI,
+    const std::vector<std::string> &signalPaths,
+    const ValueCallback &userCallback,
+    const SubscribeOptions &options) {
+    Consumer consumer;
+    consumer.onValue = userCallback;
+    addSubscription(internPaths(serverURI, ValueField::Current, signalPaths), consumer, options);
+}
+
+void VAPIClient::subscribeTargetValues(const std::string &serverURI,
+    const std::vector<std::string> &signalPaths,
+    const ValueCallback &userCallback,
+    const SubscribeOptions &options) {
+    Consumer consumer;
+    consumer.onValue = userCallback;
+    addSubscription(internPaths(serverURI, ValueField::Target, signalPaths), consumer, options);
+}
+
+void VAPIClient::subscribeHandle(SignalHandle handle, const HandleCallback &userCallback,
+    const SubscribeOptions &options) {
+    Consumer consumer;
+    consumer.onHandle = userCallback;
+    addSubscription({handle}, consumer, options);
+}
+
+size_t VAPIClient::upstreamSubscriptionCount() {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    size_t count = 0;
+    for (const auto &slot : mSlots) {
+        if (slot.consumers) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool VAPIClient::shadowValue(const std::string &serverURI, ValueField field,
+    const std::string &path, std::string &value) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    if (mShadowMaxAgeMs < 0) {
+        return false;
+    }
+    auto it = mHandles.find(hubKey(serverURI, field, path));
+    if (it == mHandles.end() || !mSlots[it->second].hasLatest) {
+        mShadowStats.misses++;
+        return false;
+    }
+    const HubSlot &slot = mSlots[it->second];
+    double ageMs = std::chrono::duration<double, std::milli>(SignalValue::Clock::now() - slot.latestAt).count();
+    if (mShadowMaxAgeMs > 0 && ageMs > mShadowMaxAgeMs) {
+        mShadowStats.misses++;
+        mShadowStats.expired++;
+        return false;
+    }
+    value = slot.latest;
+    mShadowStats.hits++;
+    mShadowAgeSumMs += ageMs;
+    mShadowStats.maxAgeMs = std::max(mShadowStats.maxAgeMs, ageMs);
+    return true;
+}
+
+void VAPIClient::invalidateShadow(const std::string &serverURI, const std::string &path) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    for (ValueField field : {ValueField::Current, ValueField::Target}) {
+        auto it = mHandles.find(hubKey(serverURI, field, path));
+        if (it != mHandles.end()) {
+            mSlots[it->second].hasLatest = false;
+        }
+    }
+}
+
+void VAPIClient::setShadowMaxAge(int maxAgeMs) {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    mShadowMaxAgeMs = maxAgeMs;
+}
+
+VAPIClient::ShadowStats VAPIClient::shadowStats() {
+    std::lock_guard<std::mutex> lock(mHubMutex);
+    ShadowStats stats = mShadowStats;
+    stats.meanAgeMs = stats.hits ? mShadowAgeSumMs / double(stats.hits) : 0.0;
+    return stats;
+}
+
+void VAPIClient::addConnectionListener(const ConnectionCallback &listener) {
+    std::lock_guard<std::mutex> lock(mListenersMutex);
+    mConnectionListeners.push_back(listener);
+}
+
+ConnectionState VAPIClient::connectionState(const std::string &serverURI) {
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    auto it = mClients.find(serverURI);
+    return it == mClients.end() ? ConnectionState::Disconnected : it->second.state;
+}
+
+VAPIClient::ReconnectStats VAPIClient::reconnectStats(const std::string &serverURI) {
+    std::lock_guard<std::mutex> lock(mClientsMutex);
+    auto it = mClients.find(serverURI);
+    return it == mClients.end() ? ReconnectStats() : it->second.stats;
+}
+
+void VAPIClient::setConnectionState(const std::string &serverURI, ConnectionState state) {
+    {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        auto it = mClients.find(serverURI);
+        if (it == mClients.end() || it->second.state == state) {
+            return;
+        }
+        it->second.state = state;
+    }
+    std::vector<ConnectionCallback> listeners;
+    {
+        std::lock_guard<std::mutex> lock(mListenersMutex);
+        listeners = mConnectionListeners;
+    }
+    for (const auto &listener : listeners) {
+        listener(serverURI, state);
+    }
+}
+
+void VAPIClient::startSupervisor() {
+    std::lock_guard<std::mutex> lock(mSuperviseMutex);
+    if (!mSupervisor.joinable() && !mSuperviseStopping) {
+        mSupervisor = std::thread(&VAPIClient::superviseLoop, this);
+    }
+}
+
+bool VAPIClient::superviseSleep(int ms) {
+    std::unique_lock<std::mutex> lock(mSuperviseMutex);
+    return !mSuperviseCv.wait_for(lock, std::chrono::milliseconds(ms), [this]() { return mSuperviseStopping; });
+}
+
+void VAPIClient::superviseLoop() {
+    while (superviseSleep(kHealthProbeMs)) {
+        std::vector<std::string> servers;
+        {
+            std::lock_guard<std::mutex> lock(mClientsMutex);
+            for (const auto &entry : mClients) {
+                if (entry.second.state == ConnectionState::Connected) {
+                    servers.push_back(entry.first);
+                }
+            }
+        }
+        for (const auto &serverURI : servers) {
+            superviseServer(serverURI);
+        }
+    }
+}
+
+void VAPIClient::superviseServer(const std::string &serverURI) {
+    // the subscribed slots of the server, resumed after a restart
+    std::vector<SignalHandle> handles;
+    std::vector<std::string> currentPaths, targetPaths;
+    {
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        for (SignalHandle handle = 0; handle < mSlots.size(); ++handle) {
+            const HubSlot &slot = mSlots[handle];
+            if (slot.consumers && slot.serverURI == serverURI) {
+                handles.push_back(handle);
+                (slot.field == ValueField::Current ? currentPaths : targetPaths).push_back(slot.path);
+            }
+        }
+    }
+    if (handles.empty()) {
+        return; // nothing to resume, gets reconnect on their own
+    }
+    // transport level: a get would fail on a healthy broker whose probed signal has no
+    // value (e.g. target values right after a restart, until someone writes them)
+    if (tcpReachable(serverURI, kHealthProbeMs)) {
+        return;
+    }
+
+    auto lost = std::chrono::steady_clock::now();
+    std::cerr << "Lost server " << serverURI << ", reconnecting." << std::endl;
+    setConnectionState(serverURI, ConnectionState::Disconnected);
+    {
+        // the streams are gone, the last values they delivered may be outdated already:
+        // gets go to the broker (and fail) until the server is back
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        for (SignalHandle handle : handles) {
+            mSlots[handle].hasLatest = false;
+        }
+    }
+
+    // the old streams are gone; a fresh client, so nothing of the old channel is reused
+    std::shared_ptr<KuksaClient::DataBrokerClient> fresh;
+    int backoffMs = kReconnectMinMs;
+    while (!tcpReachable(serverURI, kHealthProbeMs)) {
+        if (!superviseSleep(backoffMs)) {
+            return;
+        }
+        backoffMs = std::min(backoffMs * 2, kReconnectMaxMs);
+    }
+    // resubscribe as soon as the broker accepts connections, the gets below only seed values
+    fresh = std::make_shared<KuksaClient::DataBrokerClient>();
+    fresh->Connect(serverURI);
+
+    {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        ClientEntry &entry = mClients[serverURI];
+        entry.retired.push_back(std::move(entry.client));
+        if (entry.retired.size() > kRetiredClients) {
+            entry.retired.pop_front();
+        }
+        entry.client = std::move(fresh);
+        entry.generation->fetch_add(1);
+    }
+    {
+        // again: a dying old stream may have delivered meanwhile
+        std::lock_guard<std::mutex> lock(mHubMutex);
+        for (SignalHandle handle : handles) {
+            mSlots[handle].hasLatest = false;
+        }
+    }
+    for (SignalHandle handle : handles) {
+        startUpstream(handle);
+    }
+
+    // converge the consumers right away instead of waiting for each signal to change
+    ValueResults current = fetchValues(serverURI, currentPaths, ValueField::Current);
+    ValueResults target = fetchValues(serverURI, targetPaths, ValueField::Target);
+    for (SignalHandle handle : handles) {
+        std::string path;
+        ValueField field;
+        {
+            std::lock_guard<std::mutex> lock(mHubMutex);
+            path = mSlots[handle].path;
+            field = mSlots[handle].field;
+        }
+        const ValueResults &results = field == ValueField::Current ? current : target;
+        auto it = results.find(path);
+        if (it != results.end() && it->second.ok) {
+            dispatch(handle, it->second.value);
+        }
+    }
+
+    double resubscribeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lost).count();
+    {
+        std::lock_guard<std::mutex> lock(mClientsMutex);
+        ReconnectStats &stats = mClients[serverURI].stats;
+        stats.reconnects++;
+        stats.lastResubscribeMs = resubscribeMs;
+        stats.maxResubscribeMs = std::max(stats.maxResubscribeMs, resubscribeMs);
     }
+    std::cout << "Reconnected to server " << serverURI << ", " << handles.size()
+              << " signals resubscribed in " << resubscribeMs << " ms" << std::endl;
+    setConnectionState(serverURI, ConnectionState::Connected);
 }
 
 void VAPIClient::getServerInfo(const std::string &serverURI) {
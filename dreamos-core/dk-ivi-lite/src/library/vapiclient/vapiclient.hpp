@@ -2,12 +2,23 @@
 #define VAPI_CLIENT_HPP
 
 #include "KuksaClient.hpp"
+#include "signalvalue.hpp"
 #include <memory>
 #include <string>
 #include <vector>
 #include <functional>
 #include <unordered_map>
+#include <map>
 #include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <atomic>
+
+class QObject;
 
 // Define VAPI server names for consistency across your project.
 #define DK_SYSTEM_DATABROKER "127.0.0.1:55569"
@@ -75,8 +86,148 @@ namespace VehicleAPI {
     };
 }
 
+// Which value of a signal a request is about.
+enum class ValueField {
+    Current,
+    Target
+};
+
+// Connection of VAPIClient to one server, see VAPIClient::connectionState.
+enum class ConnectionState {
+    Connecting,
+    Connected,
+    // probe failed, reconnecting
+    Disconnected
+};
+
+// Result of one path of a batched get (see VAPIClient::getValues).
+struct ValueResult {
+    bool ok = false;
+    // set by the async API when the deadline passed before the broker answered
+    bool timedOut = false;
+    std::string value;
+
+    bool asBool() const { return ok && (value == "true"); }
+    // The value parsed into a SignalValue, invalid if the get failed.
+    SignalValue toSignalValue() const { return ok ? SignalValue::parse(value) : SignalValue(); }
+    // Returns false if the value is missing or not a number.
+    bool asInt(int &out) const {
+        if (!ok) return false;
+        try {
+            out = std::stoi(value);
+            return true;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+};
+
+using ValueResults = std::unordered_map<std::string, ValueResult>;
+
+// Small integer id of one (server, field, path) signal, see VAPIClient::signalHandle.
+// Handles are dense, starting at 0, and stay valid for the life of the process,
+// so consumers can index plain vectors with them.
+using SignalHandle = uint32_t;
+inline constexpr SignalHandle kInvalidSignalHandle = UINT32_MAX;
+
+// Writes collected for one VAPIClient::setValues call.
+class ValueBatch {
+public:
+    // Write newValue to the current and/or target value of path.
+    template<typename T>
+    ValueBatch &set(const std::string &path, const T &newValue, bool current = true, bool target = true) {
+        if (current) {
+            mWrites.push_back([path, newValue](KuksaClient::DataBrokerClient &client) {
+                client.SetCurrentValue(path, newValue);
+            });
+        }
+        if (target) {
+            mWrites.push_back([path, newValue](KuksaClient::DataBrokerClient &client) {
+                client.SetTargetValue(path, newValue);
+            });
+        }
+        mPaths.push_back(path);
+        return *this;
+    }
+
+    const std::vector<std::string> &paths() const { return mPaths; }
+    bool empty() const { return mWrites.empty(); }
+
+private:
+    friend class VAPIClient;
+    std::vector<std::function<void(KuksaClient::DataBrokerClient &)>> mWrites;
+    std::vector<std::string> mPaths;
+};
+
+// Per-subscription delivery options, applied by the VAPIClient hub to each consumer
+// (and each path of it) before its callback runs. The default delivers every update.
+struct SubscribeOptions {
+    // at most this many updates per second, 0 for no limit; of the updates inside the
+    // interval only the newest is kept, it is delivered when the interval ends
+    double maxRateHz = 0.0;
+    // numeric values: skip updates closer than this to the last delivered value
+    double deadband = 0.0;
+    // skip updates equal to the last delivered value
+    bool onChangeOnly = false;
+
+    bool filters() const { return maxRateHz > 0.0 || deadband > 0.0 || onChangeOnly; }
+};
+
+// State of SubscribeOptions for one consumer of one signal.
+class UpdateFilter {
+public:
+    explicit UpdateFilter(const SubscribeOptions &options);
+
+    enum class Result {
+        Deliver,
+        Drop,
+        // held back by maxRateHz: call takePending() at flushAt. Only returned for the first value
+        // held back in an interval, later ones replace it (and return Drop).
+        Defer
+    };
+    // raw: the update as the broker sent it, kept with a held back value for string consumers.
+    Result accept(const SignalValue &value, const std::string &raw, SignalValue::Clock::time_point &flushAt);
+    // The held back value, if it is still due (no newer update was delivered or dropped meanwhile);
+    // it counts as delivered now.
+    bool takePending(SignalValue &value, std::string &raw);
+
+private:
+    SubscribeOptions mOptions;
+    SignalValue::Clock::duration mMinInterval{0};
+    std::mutex mMutex;
+    bool mHasLast = false;
+    SignalValue mLast;
+    SignalValue::Clock::time_point mLastAt;
+    bool mHasPending = false;
+    SignalValue mPending;
+    std::string mPendingRaw;
+};
+
+// Threads draining a FIFO of jobs, started on the first push.
+// With one thread the jobs run in submission order.
+class TaskQueue {
+public:
+    explicit TaskQueue(size_t threadCount) : mThreadCount(threadCount) {}
+    ~TaskQueue();
+
+    void push(std::function<void()> job);
+
+private:
+    void loop();
+
+    size_t mThreadCount;
+    std::vector<std::thread> mThreads;
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::deque<std::function<void()>> mJobs;
+    bool mStopping = false;
+};
+
 // In VAPIClient.h
+// The stream of one hub slot; owns a reference to its client so a client replaced by a
+// reconnect lives until its last stream has ended (manager is destroyed first).
 struct SubscriptionEntry {
+    std::shared_ptr<KuksaClient::DataBrokerClient> client;
     std::unique_ptr<KuksaClient::SubscriptionManager> manager;
 };
 
@@ -102,6 +253,7 @@ public:
 
     // Retrieves the current value for a given path on the specified server.
     // Returns true if successful; false otherwise.
+    // A subscribed path is answered from the shadow cache (see setShadowMaxAge).
     bool getCurrentValue(const std::string &serverURI,
                          const std::string &path,
                          std::string &value);
@@ -113,6 +265,7 @@ public:
         auto client = getClient(serverURI);
         if (client) {
             client->SetCurrentValue(path, newValue);
+            invalidateShadow(serverURI, path);
         } else {
             std::cerr << "Client for server " << serverURI << " not found." << std::endl;
         }
@@ -131,20 +284,170 @@ public:
         auto client = getClient(serverURI);
         if (client) {
             client->SetTargetValue(path, newValue);
+            invalidateShadow(serverURI, path);
         } else {
             std::cerr << "Client for server " << serverURI << " not found." << std::endl;
         }
     }
 
+    // Retrieves the current or target value of many paths at once, keyed by path.
+    // The paths are fetched concurrently, so the call takes about as long as the slowest
+    // single get instead of the sum of all of them. Failed paths have ok == false.
+    // Subscribed paths are answered from the shadow cache, only the rest is fetched.
+    ValueResults getValues(const std::string &serverURI,
+                           const std::vector<std::string> &paths,
+                           ValueField field = ValueField::Target);
+
+    //--------------------------------------------------------------------------
+    // Non-blocking API, safe to call from the GUI thread.
+    //
+    // Calls run on the VAPIClient worker threads. The returned future becomes ready
+    // with the result, or with a failed one (timedOut set) once timeoutMs passed.
+    // With a context, done is invoked on the thread of context through its event
+    // loop, and dropped if context is gone by then; call these from that thread.
+    // Without a context done runs on a worker thread and no deadline is applied,
+    // the caller bounds its own wait on the future.
+    //--------------------------------------------------------------------------
+    static constexpr int kDefaultCallTimeoutMs = 2000;
+
+    template<typename Result>
+    using Completion = std::function<void(const Result &)>;
+
+    std::shared_future<bool> connectToServerAsync(const std::string &serverURI,
+                                                  QObject *context = nullptr,
+                                                  Completion<bool> done = nullptr,
+                                                  int timeoutMs = 5 * kDefaultCallTimeoutMs);
+
+    std::shared_future<ValueResult> getCurrentValueAsync(const std::string &serverURI,
+                                                         const std::string &path,
+                                                         QObject *context = nullptr,
+                                                         Completion<ValueResult> done = nullptr,
+                                                         int timeoutMs = kDefaultCallTimeoutMs);
+
+    std::shared_future<ValueResult> getTargetValueAsync(const std::string &serverURI,
+                                                        const std::string &path,
+                                                        QObject *context = nullptr,
+                                                        Completion<ValueResult> done = nullptr,
+                                                        int timeoutMs = kDefaultCallTimeoutMs);
+
+    std::shared_future<ValueResults> getValuesAsync(const std::string &serverURI,
+                                                    const std::vector<std::string> &paths,
+                                                    ValueField field = ValueField::Target,
+                                                    QObject *context = nullptr,
+                                                    Completion<ValueResults> done = nullptr,
+                                                    int timeoutMs = kDefaultCallTimeoutMs);
+
+    // Writes all values of the batch and returns right away; the writes run on the
+    // VAPIClient writer thread (in submission order) and are issued side by side.
+    // If verify is set, the target values of the batch paths are read back afterwards
+    // and handed to it (delivered like done above).
+    using VerifyCallback = Completion<ValueResults>;
+    std::shared_future<ValueResults> setValues(const std::string &serverURI, ValueBatch batch,
+                                               VerifyCallback verify = nullptr,
+                                               QObject *context = nullptr,
+                                               int timeoutMs = kDefaultCallTimeoutMs);
+
     // Subscribe to a set of signal paths (with a callback) on the specified server.
-    // Each call creates a new SubscriptionManager for the given paths.
+    // Subscriptions go through a hub: a path that is already subscribed on that server
+    // (same field) only gets the new callback added, its upstream stream is shared.
+    // A SubscriptionManager is created for the paths that are new to the hub.
+    // This only saves threads when several consumers subscribe the same path: every distinct
+    // signal still costs one KuksaClient stream and thread, as before the hub.
+    // Returns right away, the subscription starts once the server is connected.
+    // options filter the updates of this subscription only, other consumers of the
+    // same path still get theirs.
     void subscribe(const std::string &serverURI,
                    const std::vector<std::string> &signalPaths,
-                   const KuksaClient::DataBrokerClient::Callback &userCallback);
+                   const KuksaClient::DataBrokerClient::Callback &userCallback,
+                   const SubscribeOptions &options = SubscribeOptions());
 
     void subscribeTarget(const std::string &serverURI,
                    const std::vector<std::string> &signalPaths,
-                   const KuksaClient::DataBrokerClient::Callback &userCallback);
+                   const KuksaClient::DataBrokerClient::Callback &userCallback,
+                   const SubscribeOptions &options = SubscribeOptions());
+
+    // Same subscriptions with typed values. An update is parsed once in the hub no matter
+    // how many typed consumers a path has; the string callbacks above get the text as is.
+    using ValueCallback = std::function<void(const std::string &path, const SignalValue &value)>;
+    void subscribeValues(const std::string &serverURI,
+                         const std::vector<std::string> &signalPaths,
+                         const ValueCallback &userCallback,
+                         const SubscribeOptions &options = SubscribeOptions());
+
+    void subscribeTargetValues(const std::string &serverURI,
+                         const std::vector<std::string> &signalPaths,
+                         const ValueCallback &userCallback,
+                         const SubscribeOptions &options = SubscribeOptions());
+
+    // Resolves a signal to its handle, interning it on first use; does not subscribe.
+    SignalHandle signalHandle(const std::string &serverURI, ValueField field, const std::string &path);
+    // The path of a handle, empty for an unknown one.
+    std::string signalPath(SignalHandle handle);
+
+    // Per-handle subscription: updates of that signal only, identified by handle.
+    // Dispatch is an index into the hub's slot table, no string is touched per update.
+    using HandleCallback = std::function<void(SignalHandle handle, const SignalValue &value)>;
+    void subscribeHandle(SignalHandle handle, const HandleCallback &userCallback,
+                         const SubscribeOptions &options = SubscribeOptions());
+
+    // Number of upstream subscription streams, for diagnostics and bench/vapi_subscription_bench.
+    size_t upstreamSubscriptionCount();
+
+    //--------------------------------------------------------------------------
+    // Shadow cache
+    //
+    // Every subscribed signal keeps the last value its subscription delivered, and the
+    // gets above answer from it instead of asking the broker. A value older than the
+    // max age (kShadowMaxAgeMs unless set) is not served, the get goes to the broker:
+    // the broker only sends changes, but a stream that stalled without an error must
+    // not leave a get on an old value forever. 0 serves values of any age, -1 turns
+    // shadow reads off. A write through VAPIClient drops the entry of the written path
+    // until the subscription reports the path again.
+    //--------------------------------------------------------------------------
+    struct ShadowStats {
+        uint64_t hits = 0;
+        // not subscribed, no value yet, or too old
+        uint64_t misses = 0;
+        // the part of misses that had a value, older than the max age
+        uint64_t expired = 0;
+        // age of the values served from memory
+        double meanAgeMs = 0.0;
+        double maxAgeMs = 0.0;
+
+        double hitRate() const { return hits + misses ? double(hits) / double(hits + misses) : 0.0; }
+    };
+    static constexpr int kShadowMaxAgeMs = 5000;
+    void setShadowMaxAge(int maxAgeMs);
+    ShadowStats shadowStats();
+
+    //--------------------------------------------------------------------------
+    // Connection supervision
+    //
+    // A databroker restart silently ends the subscription streams. Once a server has
+    // subscriptions, a health thread opens a TCP connection to it every kHealthProbeMs.
+    // When that fails the server is Disconnected and its shadow values are dropped;
+    // VAPIClient retries the connection from kReconnectMinMs up to kReconnectMaxMs apart,
+    // then connects a fresh DataBrokerClient, re-subscribes every hub slot of the server
+    // and seeds the consumers and the shadow cache with one bulk get (a signal without a
+    // value is just not seeded). Updates still arriving from the old streams are dropped;
+    // the old streams are joined in the background and their client released after them.
+    //--------------------------------------------------------------------------
+    static constexpr int kHealthProbeMs = 1000;
+    static constexpr int kReconnectMinMs = 250;
+    static constexpr int kReconnectMaxMs = 8000;
+
+    // Called on the VAPIClient threads whenever the state of a server changes.
+    using ConnectionCallback = std::function<void(const std::string &serverURI, ConnectionState state)>;
+    void addConnectionListener(const ConnectionCallback &listener);
+    ConnectionState connectionState(const std::string &serverURI);
+
+    struct ReconnectStats {
+        uint64_t reconnects = 0;
+        // from the failed probe until every slot was subscribed and seeded again
+        double lastResubscribeMs = 0.0;
+        double maxResubscribeMs = 0.0;
+    };
+    ReconnectStats reconnectStats(const std::string &serverURI);
 
     // Convenience method to retrieve server info from the specified server.
     void getServerInfo(const std::string &serverURI);
@@ -159,14 +462,136 @@ private:
 
     // Helper to check if a client exists for the given serverURI.
     // Returns pointer to the client if found, else nullptr.
-    KuksaClient::DataBrokerClient* getClient(const std::string &serverURI);
+    // Waits for a connect of serverURI that is still in progress.
+    // generation, if set, receives the client generation of the returned client; owner a reference to it.
+    KuksaClient::DataBrokerClient* getClient(const std::string &serverURI,
+                                             std::shared_ptr<std::atomic<uint64_t>> *generation = nullptr,
+                                             uint64_t *clientGeneration = nullptr,
+                                             std::shared_ptr<KuksaClient::DataBrokerClient> *owner = nullptr);
+
+    // Registers a client for serverURI, ready once the connect resolves ready.
+    // Returns nullptr if there is one already.
+    KuksaClient::DataBrokerClient* addClient(const std::string &serverURI, std::shared_future<void> ready);
+
+    template<typename Result>
+    std::shared_future<Result> runAsync(TaskQueue &queue, std::function<Result()> call, Result failed,
+                                        QObject *context, Completion<Result> done, int timeoutMs);
+
+    struct ClientEntry {
+        std::shared_ptr<KuksaClient::DataBrokerClient> client;
+        std::shared_future<void> ready;
+        // bumped when a reconnect replaces client; updates of older streams are dropped
+        std::shared_ptr<std::atomic<uint64_t>> generation = std::make_shared<std::atomic<uint64_t>>(0);
+        ConnectionState state = ConnectionState::Connecting;
+        ReconnectStats stats;
+        // the last replaced clients, kept for the gets that may still run on them
+        // (their streams hold references of their own)
+        std::deque<std::shared_ptr<KuksaClient::DataBrokerClient>> retired;
+    };
+    static constexpr size_t kRetiredClients = 2;
 
     // Mapping from server URI to the corresponding DataBrokerClient instance.
-    std::unordered_map<std::string, std::unique_ptr<KuksaClient::DataBrokerClient>> mClients;
+    std::unordered_map<std::string, ClientEntry> mClients;
+    std::mutex mClientsMutex;
+
+    // The current stream of each hub slot; a restarted upstream replaces it.
+    std::unordered_map<SignalHandle, SubscriptionEntry> mSubscriptionManagers;
+    std::mutex mSubscriptionMutex;
+
+    // Subscription hub, one slot per (server, field, path), indexed by SignalHandle.
+    // One subscriber of a slot, exactly one of the callbacks is set.
+    struct Consumer {
+        KuksaClient::DataBrokerClient::Callback onString;
+        ValueCallback onValue;
+        HandleCallback onHandle;
+        // null without SubscribeOptions filtering
+        std::shared_ptr<UpdateFilter> filter;
+    };
+    struct Consumers {
+        std::vector<Consumer> list;
+        // whether dispatch has to look up the path / parse the update
+        bool needsPath = false;
+        bool needsValue = false;
+    };
+    struct HubSlot {
+        std::string serverURI;
+        std::string path;
+        ValueField field;
+        // replaced, never modified, so dispatch can run the callbacks without holding the lock;
+        // null until the first consumer subscribed
+        std::shared_ptr<const Consumers> consumers;
+        // client generation the upstream stream runs on, -1 for none
+        int64_t upstreamGeneration = -1;
+        // shadow cache: the last value the subscription delivered
+        bool hasLatest = false;
+        std::string latest;
+        SignalValue::Clock::time_point latestAt;
+    };
+    static std::string hubKey(const std::string &serverURI, ValueField field, const std::string &path);
+    SignalHandle internLocked(const std::string &serverURI, ValueField field, const std::string &path);
+    std::vector<SignalHandle> internPaths(const std::string &serverURI, ValueField field,
+                                          const std::vector<std::string> &paths);
+    // Adds consumer to the slot of each handle, with a filter of its own per slot;
+    // starts the upstream subscription of the slots that had none.
+    void addSubscription(const std::vector<SignalHandle> &handles, const Consumer &consumer,
+                         const SubscribeOptions &options);
+    // Starts the stream of a slot on the current client of its server, unless it has one there.
+    void startUpstream(SignalHandle handle);
+    // Joins the threads of a replaced stream in the background, then releases it.
+    static void retireSubscription(SubscriptionEntry entry);
+    void dispatch(SignalHandle handle, const std::string &value);
+    static void deliver(const Consumer &consumer, SignalHandle handle, const std::string &path,
+                        const std::string &raw, const SignalValue &typed);
+    std::unordered_map<std::string, SignalHandle> mHandles;
+    std::vector<HubSlot> mSlots;
+    std::mutex mHubMutex;
+
+    // Shadow cache lookups, under mHubMutex like the slots they read.
+    bool shadowValue(const std::string &serverURI, ValueField field, const std::string &path, std::string &value);
+    void invalidateShadow(const std::string &serverURI, const std::string &path);
+    // getValues without the shadow cache
+    ValueResults fetchValues(const std::string &serverURI, const std::vector<std::string> &paths, ValueField field);
+    int mShadowMaxAgeMs = kShadowMaxAgeMs;
+    ShadowStats mShadowStats;
+    double mShadowAgeSumMs = 0.0;
+
+    // Trailing edge of SubscribeOptions::maxRateHz: values held back by a filter are
+    // delivered by one thread when their interval ends.
+    struct PendingFlush {
+        SignalHandle handle;
+        Consumer consumer;
+    };
+    void scheduleFlush(SignalValue::Clock::time_point at, SignalHandle handle, const Consumer &consumer);
+    void flushLoop();
+    std::multimap<SignalValue::Clock::time_point, PendingFlush> mFlushes;
+    std::thread mFlusher;
+    std::mutex mFlushMutex;
+    std::condition_variable mFlushCv;
+    bool mFlushStopping = false;
 
-    // Container for persistent SubscriptionManager objects.
-    std::vector<SubscriptionEntry> mSubscriptionManagers;
+    // Connection supervision
+    void setConnectionState(const std::string &serverURI, ConnectionState state);
+    void startSupervisor();
+    void superviseLoop();
+    // Probes serverURI, reconnects and resumes it if the probe fails.
+    void superviseServer(const std::string &serverURI);
+    // false if the supervisor is stopping
+    bool superviseSleep(int ms);
+    std::vector<ConnectionCallback> mConnectionListeners;
+    std::mutex mListenersMutex;
+    std::thread mSupervisor;
+    std::mutex mSuperviseMutex;
+    std::condition_variable mSuperviseCv;
+    bool mSuperviseStopping = false;
 
+    // Declared last: joined before the clients they use are destroyed (the supervisor
+    // is stopped in ~VAPIClient already).
+    // mFetchers runs the single path gets of fetchValues, not mWorkers whose jobs wait
+    // for them; declared first so it is joined after the queues waiting on it.
+    static constexpr size_t kFetchThreads = 8;
+    TaskQueue mFetchers{kFetchThreads};
+    TaskQueue mWriter{1};
+    TaskQueue mWorkers{4};
 };
 
 } // namespace VAPI
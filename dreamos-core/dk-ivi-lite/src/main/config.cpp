@@ -21,6 +21,7 @@ void Config::loadDefaults() {
     m_vapiDataBroker = "127.0.0.1:55555";
     m_systemDataBroker = "127.0.0.1:55569";
     m_qtBackend = "software";
+    m_managerMode = "subprocess";
     m_enableDebug = false;
     m_showVersion = false;
     m_showHelp = false;
@@ -55,6 +56,10 @@ bool Config::parseArguments(int argc, char *argv[]) {
                                       "Qt Quick backend (software, opengl, vulkan)",
                                       "backend", m_qtBackend);
     
+    QCommandLineOption managerModeOption(QStringList() << "m" << "manager-mode",
+                                        "How dk_manager is run (subprocess, inprocess)",
+                                        "mode", m_managerMode);
+    
     QCommandLineOption debugOption(QStringList() << "d" << "debug",
                                   "Enable debug mode with verbose output");
     
@@ -68,6 +73,7 @@ bool Config::parseArguments(int argc, char *argv[]) {
     parser.addOption(vapiOption);
     parser.addOption(systemOption);
     parser.addOption(qtBackendOption);
+    parser.addOption(managerModeOption);
     parser.addOption(debugOption);
     parser.addOption(versionOption);
     parser.addHelpOption();
@@ -105,6 +111,7 @@ bool Config::parseArguments(int argc, char *argv[]) {
     m_vapiDataBroker = parser.value(vapiOption);
     m_systemDataBroker = parser.value(systemOption);
     m_qtBackend = parser.value(qtBackendOption);
+    m_managerMode = parser.value(managerModeOption);
     m_enableDebug = parser.isSet(debugOption);
     
     // If debug is enabled, override log level
@@ -138,6 +145,8 @@ void Config::showHelp(const QString& programName) const {
     std::cout << "                             (IP:PORT - default: 127.0.0.1:55569)" << std::endl;
     std::cout << "  -b, --qt-backend <backend> Qt Quick backend" << std::endl;
     std::cout << "                             (software, opengl, vulkan - default: software)" << std::endl;
+    std::cout << "  -m, --manager-mode <mode>  How dk_manager is run" << std::endl;
+    std::cout << "                             (subprocess, inprocess - default: subprocess)" << std::endl;
     std::cout << "  -d, --debug                Enable debug mode with verbose output" << std::endl;
     std::cout << "  -V, --version              Show version information" << std::endl;
     std::cout << "  -h, --help                 Show this help message" << std::endl;
@@ -170,6 +179,14 @@ bool Config::validateConfiguration() const {
         return false;
     }
     
+    // Validate dk_manager mode
+    QStringList validManagerModes = {"subprocess", "inprocess"};
+    if (!validManagerModes.contains(m_managerMode.toLower())) {
+        std::cerr << "Error: Invalid manager mode '" << m_managerMode.toStdString() 
+                  << "'. Valid modes: subprocess, inprocess" << std::endl;
+        return false;
+    }
+    
     // Validate data broker endpoints (basic IP:PORT format check)
     QRegularExpression endpointPattern("^\\d+\\.\\d+\\.\\d+\\.\\d+:\\d+$");
     if (!endpointPattern.match(m_vapiDataBroker).hasMatch()) {
@@ -222,6 +239,7 @@ void Config::printConfiguration() const {
     qCInfo(configLog) << "VAPI Data Broker:  " << m_vapiDataBroker;
     qCInfo(configLog) << "System Data Broker:" << m_systemDataBroker;
     qCInfo(configLog) << "Qt Backend:        " << m_qtBackend;
+    qCInfo(configLog) << "Manager Mode:      " << m_managerMode;
     qCInfo(configLog) << "Debug Mode:        " << (m_enableDebug ? "enabled" : "disabled");
     qCInfo(configLog) << "============================";
 }
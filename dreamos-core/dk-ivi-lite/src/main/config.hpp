@@ -25,6 +25,7 @@ public:
     QString vapiDataBroker() const { return m_vapiDataBroker; }
     QString systemDataBroker() const { return m_systemDataBroker; }
     QString qtBackend() const { return m_qtBackend; }
+    QString managerMode() const { return m_managerMode; }
     bool enableDebug() const { return m_enableDebug; }
     bool showVersion() const { return m_showVersion; }
     bool showHelp() const { return m_showHelp; }
@@ -45,6 +46,7 @@ private:
     QString m_vapiDataBroker;
     QString m_systemDataBroker;
     QString m_qtBackend;
+    QString m_managerMode;
     bool m_enableDebug;
     bool m_showVersion;
     bool m_showHelp;
@@ -0,0 +1,27 @@
+#ifndef DKMANAGER_HOST_HPP
+#define DKMANAGER_HOST_HPP
+
+#include <QObject>
+#include <QString>
+
+// How dk_ivi runs dk_manager: as a child process (DkManagerSubprocess) or,
+// when built with DK_IVI_INPROCESS_MANAGER, on a thread of dk_ivi itself (DkManagerInProcess).
+class DkManagerHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DkManagerHost(QObject *parent = nullptr) : QObject(parent) {}
+    virtual ~DkManagerHost() {}
+
+    virtual bool startManager() = 0;
+    virtual void stopManager() = 0;
+    virtual bool isRunning() const = 0;
+
+signals:
+    void managerStarted();
+    void managerStopped();
+    void managerError(const QString &errorMessage);
+};
+
+#endif // DKMANAGER_HOST_HPP
@@ -0,0 +1,54 @@
+#include "dkmanager_inprocess.hpp"
+
+DkManagerInProcess::DkManagerInProcess(QObject *parent)
+    : DkManagerHost(parent)
+{
+    connect(&m_core, &DkManagerCore::started, this, &DkManagerInProcess::managerStarted);
+    connect(&m_core, &DkManagerCore::stopped, this, &DkManagerInProcess::managerStopped);
+    connect(&m_core, &DkManagerCore::connectionChanged, this, &DkManagerInProcess::connectionChanged);
+    connect(&m_core, &DkManagerCore::messageToKitHandled, this, &DkManagerInProcess::messageToKitHandled);
+}
+
+DkManagerInProcess::~DkManagerInProcess()
+{
+    stopManager();
+}
+
+bool DkManagerInProcess::startManager()
+{
+    if (isRunning()) {
+        qCWarning(dkManagerLog) << "dk_manager is already running";
+        return true;
+    }
+
+    qCInfo(dkManagerLog) << "Starting dk_manager in-process";
+
+    // same setup as the embedded subprocess: no remote tooling, no Docker operations
+    if (!m_core.Start(true, true)) {
+        QString error = "Failed to start in-process dk_manager";
+        qCCritical(dkManagerLog) << error;
+        emit managerError(error);
+        return false;
+    }
+    return true;
+}
+
+void DkManagerInProcess::stopManager()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    qCInfo(dkManagerLog) << "Stopping in-process dk_manager...";
+    m_core.Stop();
+}
+
+bool DkManagerInProcess::isRunning() const
+{
+    return m_core.IsRunning();
+}
+
+bool DkManagerInProcess::isConnected() const
+{
+    return m_core.IsConnected();
+}
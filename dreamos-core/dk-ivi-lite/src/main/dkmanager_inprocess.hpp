@@ -0,0 +1,35 @@
+#ifndef DKMANAGER_INPROCESS_HPP
+#define DKMANAGER_INPROCESS_HPP
+
+#include <QObject>
+#include <QLoggingCategory>
+#include "dkmanager_host.hpp"
+#include "dk_manager_core.h"
+
+Q_DECLARE_LOGGING_CATEGORY(dkManagerLog)
+
+// dk_manager from libdk_manager_core, running on its own thread inside dk_ivi.
+// Shares dk_ivi's Qt runtime instead of starting a second process with its own Qt, socket.io and TLS stack.
+class DkManagerInProcess : public DkManagerHost
+{
+    Q_OBJECT
+
+public:
+    explicit DkManagerInProcess(QObject *parent = nullptr);
+    ~DkManagerInProcess();
+
+    bool startManager() override;
+    void stopManager() override;
+    bool isRunning() const override;
+
+    bool isConnected() const;
+
+signals:
+    void connectionChanged(bool connected);
+    void messageToKitHandled(const QString &cmd);
+
+private:
+    DkManagerCore m_core;
+};
+
+#endif // DKMANAGER_INPROCESS_HPP
@@ -5,7 +5,7 @@
 Q_LOGGING_CATEGORY(dkManagerLog, "dk.ivi.manager")
 
 DkManagerSubprocess::DkManagerSubprocess(QObject *parent)
-    : QObject(parent)
+    : DkManagerHost(parent)
     , m_managerProcess(nullptr)
     , m_isEmbedded(true)
 {
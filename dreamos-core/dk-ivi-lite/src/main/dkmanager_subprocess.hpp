@@ -7,10 +7,11 @@
 #include <QLoggingCategory>
 #include <QStandardPaths>
 #include <QDir>
+#include "dkmanager_host.hpp"
 
 Q_DECLARE_LOGGING_CATEGORY(dkManagerLog)
 
-class DkManagerSubprocess : public QObject
+class DkManagerSubprocess : public DkManagerHost
 {
     Q_OBJECT
 
@@ -18,9 +19,9 @@ public:
     explicit DkManagerSubprocess(QObject *parent = nullptr);
     ~DkManagerSubprocess();
 
-    bool startManager();
-    void stopManager();
-    bool isRunning() const;
+    bool startManager() override;
+    void stopManager() override;
+    bool isRunning() const override;
     
     QString getManagerExecutablePath() const;
 
@@ -30,11 +31,6 @@ public slots:
     void onManagerReadyReadStandardOutput();
     void onManagerReadyReadStandardError();
 
-signals:
-    void managerStarted();
-    void managerStopped();
-    void managerError(const QString &errorMessage);
-
 private:
     QProcess *m_managerProcess;
     QString m_executablePath;
@@ -7,6 +7,9 @@
 
 #include "config.hpp"
 #include "dkmanager_subprocess.hpp"
+#ifdef DK_IVI_INPROCESS_MANAGER
+#include "dkmanager_inprocess.hpp"
+#endif
 #include "../digitalauto/digitalauto.hpp"
 #include "../marketplace/marketplace.hpp"
 #include "../installedservices/installedservices.hpp"
@@ -52,33 +55,61 @@ int main(int argc, char *argv[])
     qCDebug(mainLog) << "Qt version:" << QT_VERSION_STR;
     qCDebug(mainLog) << "Command line arguments:" << app.arguments();
 
-    // Initialize and start dk_manager subprocess
-    qCInfo(mainLog) << "Initializing dk_manager subprocess...";
-    DkManagerSubprocess dkManager(&app);
+    // Initialize and start dk_manager, as a subprocess or on a thread of dk_ivi
+    DkManagerHost *dkManager = nullptr;
+    if (config.managerMode().toLower() == "inprocess") {
+#ifdef DK_IVI_INPROCESS_MANAGER
+        qCInfo(mainLog) << "Initializing in-process dk_manager...";
+        dkManager = new DkManagerInProcess(&app);
+#else
+        qCWarning(mainLog) << "dk_ivi was built without DK_IVI_INPROCESS_MANAGER - falling back to the dk_manager subprocess";
+#endif
+    }
+    if (!dkManager) {
+        qCInfo(mainLog) << "Initializing dk_manager subprocess...";
+        dkManager = new DkManagerSubprocess(&app);
+    }
     
     // Connect manager signals for monitoring
-    QObject::connect(&dkManager, &DkManagerSubprocess::managerStarted, [&]() {
-        qCInfo(mainLog) << "dk_manager subprocess started successfully";
+    QObject::connect(dkManager, &DkManagerHost::managerStarted, [&]() {
+        qCInfo(mainLog) << "dk_manager started successfully";
     });
     
-    QObject::connect(&dkManager, &DkManagerSubprocess::managerError, [&](const QString &error) {
+    QObject::connect(dkManager, &DkManagerHost::managerError, [&](const QString &error) {
         qCWarning(mainLog) << "dk_manager error:" << error;
     });
     
-    QObject::connect(&dkManager, &DkManagerSubprocess::managerStopped, [&]() {
-        qCInfo(mainLog) << "dk_manager subprocess stopped";
+    QObject::connect(dkManager, &DkManagerHost::managerStopped, [&]() {
+        qCInfo(mainLog) << "dk_manager stopped";
     });
     
     // Start the manager
-    if (!dkManager.startManager()) {
-        qCWarning(mainLog) << "Failed to start dk_manager subprocess - continuing without it";
+    if (!dkManager->startManager()) {
+        qCWarning(mainLog) << "Failed to start dk_manager - continuing without it";
     }
 
     // VAPI Client Initialization with configurable endpoint
     QString vapiEndpoint = config.vapiDataBroker();
     qCInfo(mainLog) << "Connecting to VAPI Data Broker:" << vapiEndpoint;
     
-    VAPI_CLIENT.connectToServer(vapiEndpoint.toStdString().c_str());
+    // VAPIClient reconnects and resubscribes by itself when the broker restarts (e.g. a vss mapping deploy)
+    VAPI_CLIENT.addConnectionListener([](const std::string &server, ConnectionState state) {
+        if (state == ConnectionState::Disconnected) {
+            qCWarning(mainLog) << "Lost VAPI Data Broker, reconnecting:" << QString::fromStdString(server);
+        } else if (state == ConnectionState::Connected && VAPI_CLIENT.reconnectStats(server).reconnects > 0) {
+            qCInfo(mainLog) << "VAPI Data Broker back:" << QString::fromStdString(server)
+                            << "- resubscribed in" << VAPI_CLIENT.reconnectStats(server).lastResubscribeMs << "ms";
+        }
+    });
+
+    // does not block the GUI thread, calls made meanwhile wait for the connection on the VAPI workers
+    VAPI_CLIENT.connectToServerAsync(vapiEndpoint.toStdString(), &app, [vapiEndpoint](const bool &connected) {
+        if (connected) {
+            qCInfo(mainLog) << "Connected to VAPI Data Broker:" << vapiEndpoint;
+        } else {
+            qCWarning(mainLog) << "VAPI Data Broker did not answer in time:" << vapiEndpoint;
+        }
+    });
     // Register QML types for pages
     qCInfo(mainLog) << "Registering QML types...";
     qmlRegisterType<DigitalAutoAppAsync>("DigitalAutoAppAsync", 1, 0, "DigitalAutoAppAsync");
@@ -134,6 +165,9 @@ int main(int argc, char *argv[])
     qCInfo(mainLog) << "Starting application event loop...";
     int result = app.exec();
     
+    // stop dk_manager while the application object is still fully alive
+    delete dkManager;
+    
     qCInfo(mainLog) << "Application finished with exit code:" << result;
     return result;
 }
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+
+# Mock dapr sidecar for dk_manager without a dapr installation.
+# Serves the parts of the dapr HTTP API that dk_manager reads (metadata and health).
+#
+#   tools/mock_dapr_sidecar.py --app-id vehicledatabroker --port 3500 --app-port 55555
+
+import argparse
+import json
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+def make_handler(args):
+    metadata = {
+        "id": args.app_id,
+        "runtimeVersion": args.runtime_version,
+        "enabledFeatures": [],
+        "actors": [],
+        "components": [],
+        "extended": {"appCommand": "mock"},
+        "appConnectionProperties": {
+            "port": args.app_port,
+            "protocol": args.app_protocol,
+            "channelAddress": "127.0.0.1",
+        },
+    }
+
+    class Handler(BaseHTTPRequestHandler):
+        def do_GET(self):
+            if self.path == "/v1.0/metadata":
+                body = json.dumps(metadata).encode()
+                self.send_response(200)
+                self.send_header("Content-Type", "application/json")
+                self.send_header("Content-Length", str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+            elif self.path.startswith("/v1.0/healthz"):
+                self.send_response(204)
+                self.end_headers()
+            else:
+                self.send_response(404)
+                self.end_headers()
+
+        def log_message(self, format, *args):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock dapr sidecar metadata API")
+    parser.add_argument("--app-id", default="vehicledatabroker")
+    parser.add_argument("--port", type=int, default=3500, help="dapr HTTP port")
+    parser.add_argument("--app-port", type=int, default=55555)
+    parser.add_argument("--app-protocol", default="grpc")
+    parser.add_argument("--runtime-version", default="mock")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), make_handler(args))
+    print(f"mock dapr sidecar '{args.app_id}' on http://127.0.0.1:{args.port}")
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()